@@ -0,0 +1,219 @@
+#include "DArrays.hpp"
+#include <algorithm>
+#include <iostream>
+#include <complex>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+// Latency and bandwidth of halo swaps, over the number of dimensions, the
+// local size, the halo width, the element type and the processor grid, for
+// DArray::swap_halo and for the non-blocking HaloSwap. Every rank holds a
+// block of n points along each dimension, and all dimensions are periodic,
+// so that all ranks swap all their halos. Times are those of the slowest
+// rank in each repetition.
+//
+// Usage: mpirun -np P bench_halo [options], with options
+//   --dims   1,2,3      numbers of dimensions
+//   --sizes  8,32,128   local points along each dimension
+//   --halos  1,2        halo widths
+//   --types  f4,f8,c16  element types
+//   --grids  balanced,slab
+//   --reps   50         timed repetitions, after 5 untimed ones
+//   --json   file       write the results as JSON too
+
+// ===================================================================== //
+// comma separated list of values
+static std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (true) {
+        const size_t end = list.find(',', start);
+        out.push_back(list.substr(start, end - start));
+        if (end == std::string::npos)
+            return out;
+        start = end + 1;
+    }
+}
+
+// ===================================================================== //
+// timings of one configuration
+struct Result {
+    int                  ndims;
+    std::string           grid; // kind of grid
+    std::string          shape; // of the grid, e.g. "3x3x3"
+    int                   size;
+    int                   halo;
+    std::string           type;
+    std::string         method;
+    double               bytes; // received by each rank in a swap
+    double      percentiles[5]; // min, p50, p90, p99 and max, in seconds
+};
+
+static const char* percentile_names[5] = {"min", "p50", "p90", "p99", "max"};
+
+// ===================================================================== //
+// processor grid of given kind: as square as possible, or slabs along the
+// first dimension
+template <size_t NDIMS>
+static std::array<int, NDIMS> make_grid(const std::string& kind, int nprocs) {
+    std::array<int, NDIMS> grid;
+    grid.fill(kind == "slab" ? 1 : 0);
+    if (kind == "slab")
+        grid[0] = nprocs;
+    else
+        MPI_Dims_create(nprocs, NDIMS, grid.data());
+    return grid;
+}
+
+template <typename T, size_t NDIMS>
+static void run(std::vector<Result>& results, const std::string& type, const std::string& kind,
+                int size, int halo, int nreps) {
+    int nprocs;
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    const auto grid = make_grid<NDIMS>(kind, nprocs);
+    std::array<int, NDIMS> array_size, nhalo, is_periodic;
+    for (auto dim : DArrays::LinRange(NDIMS)) {
+        array_size[dim]  = size*grid[dim];
+        nhalo[dim]       = halo;
+        is_periodic[dim] = true;
+    }
+    DArrays::DArrayLayout<NDIMS> layout(MPI_COMM_WORLD, grid, is_periodic);
+    DArrays::DArray<T, NDIMS> a(layout, array_size, nhalo, nhalo);
+    std::fill(a.begin(), a.end(), T(1));
+
+    // all points but the in-domain ones are received
+    double interior = 1;
+    for (auto dim : DArrays::LinRange(NDIMS))
+        interior *= a.size(dim);
+    const double bytes = (a.nelements() - interior)*sizeof(T);
+
+    std::string shape;
+    for (auto dim : DArrays::LinRange(NDIMS))
+        shape += (dim ? "x" : "") + std::to_string(grid[dim]);
+
+    for (std::string method : {"swap_halo", "HaloSwap"}) {
+        std::vector<double> times;
+        for (int n = 0; n != nreps + 5; n++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            double t0 = MPI_Wtime();
+            if (method == "swap_halo") {
+                a.swap_halo();
+            } else {
+                DArrays::HaloSwap<T, NDIMS> swap(a);
+                swap.wait();
+            }
+            double t = MPI_Wtime() - t0;
+            MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+            if (n >= 5)
+                times.push_back(t);
+        }
+        std::sort(times.begin(), times.end());
+
+        Result result = {int(NDIMS), kind, shape, size, halo, type, method, bytes, {}};
+        const double q[5] = {0, 0.5, 0.9, 0.99, 1};
+        for (int p = 0; p != 5; p++)
+            result.percentiles[p] = times[std::min<size_t>(times.size() - 1, q[p]*times.size())];
+        results.push_back(result);
+
+        if (layout.rank() == 0) {
+            std::printf("%4d %-10s %6d %4d %4s %-9s %12.0f", int(NDIMS), shape.c_str(),
+                        size, halo, type.c_str(), method.c_str(), bytes);
+            for (double t : result.percentiles)
+                std::printf(" %10.2f", 1e6*t);
+            std::printf(" %10.3f\n", bytes/result.percentiles[1]/1e9);
+        }
+    }
+}
+
+template <size_t NDIMS>
+static void run(std::vector<Result>& results, const std::string& type, const std::string& kind,
+                int size, int halo, int nreps) {
+    if (type == "f4")
+        run<float, NDIMS>(results, type, kind, size, halo, nreps);
+    else if (type == "f8")
+        run<double, NDIMS>(results, type, kind, size, halo, nreps);
+    else if (type == "c16")
+        run<std::complex<double>, NDIMS>(results, type, kind, size, halo, nreps);
+    else
+        throw std::invalid_argument("unknown element type " + type);
+}
+
+int main (int argc, char* argv[]) {
+
+    DArrays::MPI::Initialize();
+    {
+        std::vector<std::string> dims  = {"1", "2", "3"};
+        std::vector<std::string> sizes = {"8", "32", "128"};
+        std::vector<std::string> halos = {"1", "2"};
+        std::vector<std::string> types = {"f4", "f8", "c16"};
+        std::vector<std::string> grids = {"balanced", "slab"};
+        int nreps = 50;
+        std::string json;
+
+        for (int n = 1; n + 1 < argc; n += 2) {
+            const std::string key = argv[n], value = argv[n + 1];
+            if      (key == "--dims")  dims  = split(value);
+            else if (key == "--sizes") sizes = split(value);
+            else if (key == "--halos") halos = split(value);
+            else if (key == "--types") types = split(value);
+            else if (key == "--grids") grids = split(value);
+            else if (key == "--reps")  nreps = std::atoi(value.c_str());
+            else if (key == "--json")  json  = value;
+            else throw std::invalid_argument("unknown option " + key);
+        }
+
+        int rank;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        if (rank == 0)
+            std::printf("%4s %-10s %6s %4s %4s %-9s %12s %10s %10s %10s %10s %10s %10s\n",
+                        "dims", "grid", "size", "halo", "type", "method", "bytes",
+                        "min [us]", "p50 [us]", "p90 [us]", "p99 [us]", "max [us]", "GB/s");
+
+        std::vector<Result> results;
+        for (const auto& d : dims)
+            for (const auto& kind : grids)
+                for (const auto& size : sizes)
+                    for (const auto& halo : halos)
+                        for (const auto& type : types) {
+                            const int n = std::atoi(size.c_str()), h = std::atoi(halo.c_str());
+                            // halos must be narrower than the local blocks,
+                            // and slabs are the balanced grid in 1D
+                            if (h >= n or (d == "1" and kind == "slab"))
+                                continue;
+                            switch (std::atoi(d.c_str())) {
+                                case 1: run<1>(results, type, kind, n, h, nreps); break;
+                                case 2: run<2>(results, type, kind, n, h, nreps); break;
+                                case 3: run<3>(results, type, kind, n, h, nreps); break;
+                                default: throw std::invalid_argument("dimensions must be 1, 2 or 3");
+                            }
+                        }
+
+        if (rank == 0 and !json.empty()) {
+            FILE* file = std::fopen(json.c_str(), "w");
+            if (file == nullptr)
+                throw std::runtime_error("cannot open file " + json);
+            int nprocs;
+            MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+            std::fprintf(file, "{\n  \"benchmark\": \"halo\",\n  \"nprocs\": %d,\n  \"results\": [\n", nprocs);
+            for (size_t n = 0; n != results.size(); n++) {
+                const Result& r = results[n];
+                std::fprintf(file, "    {\"ndims\": %d, \"grid\": \"%s\", \"shape\": \"%s\", \"size\": %d, \"halo\": %d, "
+                                   "\"type\": \"%s\", \"method\": \"%s\", \"bytes\": %.0f",
+                             r.ndims, r.grid.c_str(), r.shape.c_str(), r.size, r.halo, r.type.c_str(),
+                             r.method.c_str(), r.bytes);
+                for (int p = 0; p != 5; p++)
+                    std::fprintf(file, ", \"%s\": %.9e", percentile_names[p], r.percentiles[p]);
+                std::fprintf(file, "}%s\n", n + 1 != results.size() ? "," : "");
+            }
+            std::fprintf(file, "  ]\n}\n");
+            std::fclose(file);
+        }
+    }
+    DArrays::MPI::Finalize();
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include "DArrays.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+// Cost of the ways of looping over the in-domain points of a 3D array, on
+// a copy and on a 7 point stencil, in ns per point:
+//   IndexRange  for (auto [i, j, k] : a.indices()), i.e. the iterator of
+//               IndexRange, whose increment carries over dimensions
+//   operator()  nested loops over i, j and k indexing with a(i, j, k)
+//   pointer     nested loops over raw pointers and strides
+//   scalar      the pointer loops with vectorisation disabled
+// Build with -DDARRAY_ARRAY_CHECKBOUNDS=true, as bench_indexing_checkbounds,
+// to time operator() with bounds checking.
+//
+// The vec? columns only guess from timing whether a loop is vectorised:
+// yes if it runs closer to the pointer loop than to the scalar loop, and
+// n/a when these are too close to tell. Memory bound loops, e.g. copies of
+// arrays out of cache, can be guessed wrong either way. The compiler tells
+// for sure: the CMake build passes -fopt-info-vec-optimized to GCC and
+// -Rpass=loop-vectorize to Clang for bench_indexing, which list the
+// vectorised loops with their line numbers.
+//
+// Usage: bench_indexing [n ...] [--max-ratio r], for arrays of n^3 points,
+// 16, 64 and 128 by default. With --max-ratio, the exit code is non zero
+// if the IndexRange loop is more than r times slower than the operator()
+// loop on any case, so that the benchmark can be run as a regression test.
+
+#if defined(__clang__)
+    #define NO_VECTORIZE
+    #define NO_VECTORIZE_LOOP _Pragma("clang loop vectorize(disable) interleave(disable)")
+#elif defined(__GNUC__)
+    #define NO_VECTORIZE __attribute__((optimize("no-tree-vectorize")))
+    #define NO_VECTORIZE_LOOP
+#else
+    #define NO_VECTORIZE
+    #define NO_VECTORIZE_LOOP
+#endif
+
+using Array = DArrays::DArray<double, 3>;
+
+// keeps the compiler from eliding the loops
+static volatile double sink;
+
+// ===================================================================== //
+// kernels, by name of the loop
+enum class Kernel { COPY, STENCIL };
+
+template <Kernel K>
+static void index_range(Array& b, Array& a) {
+    for (auto [i, j, k] : a.indices())
+        if constexpr (K == Kernel::COPY)
+            b(i, j, k) = a(i, j, k);
+        else
+            b(i, j, k) = a(i-1, j, k) + a(i+1, j, k) + a(i, j-1, k) + a(i, j+1, k)
+                       + a(i, j, k-1) + a(i, j, k+1) - 6*a(i, j, k);
+}
+
+template <Kernel K>
+static void nested(Array& b, Array& a) {
+    for (int k = 0; k != a.size(2); k++)
+        for (int j = 0; j != a.size(1); j++)
+            for (int i = 0; i != a.size(0); i++)
+                if constexpr (K == Kernel::COPY)
+                    b(i, j, k) = a(i, j, k);
+                else
+                    b(i, j, k) = a(i-1, j, k) + a(i+1, j, k) + a(i, j-1, k) + a(i, j+1, k)
+                               + a(i, j, k-1) + a(i, j, k+1) - 6*a(i, j, k);
+}
+
+// the raw pointer loops, with and without vectorisation
+#define POINTER_LOOP(PRAGMA)                                                        \
+    const auto s = a.strides();                                                     \
+    const int  n = a.size(0);                                                       \
+    for (int k = 0; k != a.size(2); k++)                                            \
+        for (int j = 0; j != a.size(1); j++) {                                      \
+            const double* __restrict__ src = a.cursor({0, j, k}).ptr();             \
+            double*       __restrict__ dst = b.cursor({0, j, k}).ptr();             \
+            PRAGMA                                                                  \
+            for (int i = 0; i < n; i++)                                             \
+                if constexpr (K == Kernel::COPY)                                    \
+                    dst[i] = src[i];                                                \
+                else                                                                \
+                    dst[i] = src[i-1] + src[i+1] + src[i-s[1]] + src[i+s[1]]        \
+                           + src[i-s[2]] + src[i+s[2]] - 6*src[i];                  \
+        }
+
+template <Kernel K>
+static void pointer(Array& b, Array& a) {
+    POINTER_LOOP()
+}
+
+template <Kernel K>
+NO_VECTORIZE static void scalar(Array& b, Array& a) {
+    POINTER_LOOP(NO_VECTORIZE_LOOP)
+}
+
+// ===================================================================== //
+// best time of a few runs of a loop, each repeated for at least 20 ms, in
+// ns per point
+template <typename F>
+static double ns_per_point(F f, Array& b, Array& a) {
+    const double npoints = double(a.size(0))*a.size(1)*a.size(2);
+    double best = 1e30;
+    for (int run = 0; run != 5; run++) {
+        int nreps = 0;
+        const double t0 = MPI_Wtime();
+        double t;
+        do {
+            f(b, a);
+            nreps++;
+        } while ((t = MPI_Wtime() - t0) < 0.02);
+        best = std::min(best, 1e9*t/nreps/npoints);
+        sink = b(1, 1, 1);
+    }
+    return best;
+}
+
+template <Kernel K>
+static bool run(const char* name, int n, double max_ratio) {
+    DArrays::DArrayLayout<3> layout(MPI_COMM_SELF, {1, 1, 1}, {false, false, false});
+    Array a(layout, {n, n, n}, {1, 1, 1}, {1, 1, 1});
+    Array b(layout, {n, n, n}, {1, 1, 1}, {1, 1, 1});
+    for (size_t p = 0; p != a.nelements(); p++)
+        a[p] = p % 17;
+
+    const double t_range   = ns_per_point(index_range<K>, b, a);
+    const double t_nested  = ns_per_point(nested<K>,      b, a);
+    const double t_pointer = ns_per_point(pointer<K>,     b, a);
+    const double t_scalar  = ns_per_point(scalar<K>,      b, a);
+
+    auto vectorised = [&](double t) -> const char* {
+        if (std::abs(t_scalar - t_pointer) < 0.1*t_scalar)
+            return "n/a";
+        return t < 0.5*(t_pointer + t_scalar) ? "yes" : "no";
+    };
+
+    std::printf("%-8s %5d %12.3f %-4s %12.3f %-4s %12.3f %12.3f %10.2f\n", name, n,
+                t_range, vectorised(t_range), t_nested, vectorised(t_nested),
+                t_pointer, t_scalar, t_range/t_nested);
+    return max_ratio <= 0 or t_range <= max_ratio*t_nested;
+}
+
+int main (int argc, char* argv[]) {
+
+    DArrays::MPI::Initialize();
+    int status = 0;
+    {
+        std::vector<int> sizes;
+        double max_ratio = 0;
+        for (int n = 1; n < argc; n++) {
+            if (std::string(argv[n]) == "--max-ratio" and n + 1 < argc)
+                max_ratio = std::atof(argv[++n]);
+            else
+                sizes.push_back(std::atoi(argv[n]));
+        }
+        if (sizes.empty())
+            sizes = {16, 64, 128};
+
+        std::printf("bounds checking: %s\n", DARRAY_ARRAY_CHECKBOUNDS ? "on" : "off");
+        std::printf("%-8s %5s %12s %-4s %12s %-4s %12s %12s %10s\n", "kernel", "n",
+                    "IndexRange", "vec?", "operator()", "vec?", "pointer", "scalar", "ratio");
+        std::printf("%-8s %5s %12s %-4s %12s %-4s %12s %12s %10s\n", "", "",
+                    "[ns/pt]", "", "[ns/pt]", "", "[ns/pt]", "[ns/pt]", "");
+        for (int n : sizes) {
+            bool ok = run<Kernel::COPY>("copy", n, max_ratio);
+            ok = run<Kernel::STENCIL>("stencil", n, max_ratio) and ok;
+            if (!ok) {
+                std::printf("IndexRange loop more than %g times slower than nested loops\n", max_ratio);
+                status = 1;
+            }
+        }
+    }
+    DArrays::MPI::Finalize();
+
+    return status;
+}
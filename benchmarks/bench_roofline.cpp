@@ -0,0 +1,187 @@
+#include "DArrays.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+// Achieved bandwidth and FLOP rate of the stencil kernels of DArrays, next
+// to the memory roof measured with STREAM copy and triad loops. Every rank
+// runs the same kernels on a local n^3 array at the same time, so that
+// rates are those of the node, or of a single core with one rank.
+//
+// Kernels are the 7, 13, 19 and 27 point stencils:
+//   constant  apply_stencil with constant coefficients, reading in and
+//             writing out, 16 bytes and 2p - 1 flops per point
+//   variable  apply_stencil with a user kernel, out(x) = sum_p c_p k(x + o_p)
+//             in(x + o_p), also reading k, 24 bytes and 3p - 1 flops per point
+// Bytes are the compulsory traffic, as for STREAM, without write allocate.
+// The memory roof is the arithmetic intensity times the triad bandwidth,
+// in GFLOP/s, and the last column is the fraction of it achieved: kernels
+// well below it are limited by the loops around them, or by the FLOP rate
+// of the core at high intensity.
+//
+// Usage: mpirun -np P bench_roofline [n ...] [--stream-size m], for local
+// arrays of n^3 points, 32, 64 and 128 by default, and STREAM arrays of m
+// doubles per rank, 2^23 by default.
+
+using Array = DArrays::DArray<double, 3>;
+
+// keeps the compiler from eliding the loops
+static volatile double sink;
+
+// ===================================================================== //
+// fourth order laplacian, two points along each axis
+template <typename T>
+inline DArrays::Stencil<T, 3, 13> laplacian_13pt() {
+    std::array<std::array<int, 3>, 13> offsets;
+    std::array<T, 13>                  coeffs;
+    offsets[0] = {0, 0, 0};
+    coeffs[0]  = T(-15)/2;
+    size_t n = 1;
+    for (size_t dim = 0; dim != 3; dim++)
+        for (int d : {-2, -1, 1, 2}) {
+            offsets[n]      = {0, 0, 0};
+            offsets[n][dim] = d;
+            coeffs[n]       = std::abs(d) == 1 ? T(4)/3 : T(-1)/12;
+            n++;
+        }
+    return {offsets, coeffs};
+}
+
+// ===================================================================== //
+// slowest rank time per call of f, best of a few runs, each repeated for at
+// least 50 ms
+template <typename F>
+static double seconds(F f) {
+    double best = 1e30;
+    for (int run = 0; run != 3; run++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        int nreps = 0;
+        const double t0 = MPI_Wtime();
+        double t;
+        do {
+            f();
+            nreps++;
+        } while ((t = MPI_Wtime() - t0) < 0.05);
+        t /= nreps;
+        MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        best = std::min(best, t);
+    }
+    return best;
+}
+
+// ===================================================================== //
+// STREAM copy and triad bandwidth of all ranks, in GB/s
+static std::pair<double, double> stream(size_t m, int nprocs) {
+    std::vector<double> a(m, 1.0), b(m, 2.0), c(m, 0.5);
+    const double t_copy = seconds([&]() {
+        double* __restrict__ pa = a.data();
+        const double* __restrict__ pb = b.data();
+        for (size_t i = 0; i != m; i++)
+            pa[i] = pb[i];
+        sink = pa[m/2];
+    });
+    const double t_triad = seconds([&]() {
+        double* __restrict__ pa = a.data();
+        const double* __restrict__ pb = b.data();
+        const double* __restrict__ pc = c.data();
+        for (size_t i = 0; i != m; i++)
+            pa[i] = pb[i] + 3.0*pc[i];
+        sink = pa[m/2];
+    });
+    return {nprocs*16.0*m/t_copy/1e9, nprocs*24.0*m/t_triad/1e9};
+}
+
+// ===================================================================== //
+// one row of the table, for the constant and variable coefficient kernels
+template <size_t NPOINTS>
+static void run(const char* name, const DArrays::Stencil<double, 3, NPOINTS>& stencil,
+                int n, int nprocs, double roof) {
+    DArrays::DArrayLayout<3> layout(MPI_COMM_SELF, {1, 1, 1}, {false, false, false});
+    Array in (layout, {n, n, n}, {2, 2, 2}, {2, 2, 2});
+    Array out(layout, {n, n, n}, {2, 2, 2}, {2, 2, 2});
+    Array k  (layout, {n, n, n}, {2, 2, 2}, {2, 2, 2});
+    for (size_t p = 0; p != in.nelements(); p++) {
+        in[p] = p % 17;
+        k[p]  = 1 + p % 5;
+    }
+    const double npoints = nprocs*double(n)*n*n;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // linear offsets of the points, for the variable coefficient kernel,
+    // reading k at the offset of the neighbourhood into in
+    std::array<long, NPOINTS> offsets;
+    for (size_t p = 0; p != NPOINTS; p++) {
+        const auto& o = stencil.offsets()[p];
+        offsets[p] = o[0]*in.strides()[0] + o[1]*in.strides()[1] + o[2]*in.strides()[2];
+    }
+    const auto&   coeffs = stencil.coeffs();
+    const double* base   = in.data();
+    auto kernel = [&](const DArrays::Neighbourhood<double, 3>& x) {
+        const double* u = x.ptr();
+        const double* c = k.data() + (u - base);
+        double sum = 0;
+        for (size_t p = 0; p != NPOINTS; p++)
+            sum += coeffs[p]*c[offsets[p]]*u[offsets[p]];
+        return sum;
+    };
+
+    for (bool variable : {false, true}) {
+        const double t = seconds([&]() {
+            if (variable)
+                DArrays::apply_stencil(out, in, kernel, 2);
+            else
+                DArrays::apply_stencil(out, in, stencil);
+            sink = out(0, 0, 0);
+        });
+        const double bytes = variable ? 24 : 16;
+        const double flops = variable ? 3*NPOINTS - 1 : 2*NPOINTS - 1;
+        const double gbs    = bytes*npoints/t/1e9;
+        const double gflops = flops*npoints/t/1e9;
+        if (rank == 0)
+            std::printf("%-6s %-9s %5d %10.3f %10.2f %10.2f %8.3f %10.2f %7.1f%%\n",
+                        name, variable ? "variable" : "constant", n, 1e9*t/npoints*nprocs,
+                        gbs, gflops, flops/bytes, flops/bytes*roof, 100*gflops/(flops/bytes*roof));
+    }
+}
+
+int main (int argc, char* argv[]) {
+
+    DArrays::MPI::Initialize();
+    {
+        std::vector<int> sizes;
+        size_t m = size_t(1) << 23;
+        for (int n = 1; n < argc; n++) {
+            if (std::string(argv[n]) == "--stream-size" and n + 1 < argc)
+                m = std::atol(argv[++n]);
+            else
+                sizes.push_back(std::atoi(argv[n]));
+        }
+        if (sizes.empty())
+            sizes = {32, 64, 128};
+
+        int rank, nprocs;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+        const auto [copy, triad] = stream(m, nprocs);
+        if (rank == 0) {
+            std::printf("STREAM on %d ranks: copy %.2f GB/s, triad %.2f GB/s\n\n", nprocs, copy, triad);
+            std::printf("%-6s %-9s %5s %10s %10s %10s %8s %10s %8s\n", "points", "coeffs", "n",
+                        "ns/point", "GB/s", "GFLOP/s", "flops/B", "mem roof", "of roof");
+        }
+        for (int n : sizes) {
+            run("7",  DArrays::laplacian_7pt<double>(),  n, nprocs, triad);
+            run("13", laplacian_13pt<double>(),          n, nprocs, triad);
+            run("19", DArrays::laplacian_19pt<double>(), n, nprocs, triad);
+            run("27", DArrays::laplacian_27pt<double>(), n, nprocs, triad);
+        }
+    }
+    DArrays::MPI::Finalize();
+
+    return 0;
+}
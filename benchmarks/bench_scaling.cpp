@@ -0,0 +1,287 @@
+#include "DArrays.hpp"
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <mpi.h>
+
+// Weak and strong scaling of a proxy app, with the time split between
+// compute, communication and wait, compared against a baseline. Each
+// step of the proxy app swaps the halo of an array, applies the 7 point
+// laplacian and computes the global norm of the result, i.e.
+//   comm     swap_halo
+//   compute  apply_stencil and the local pass of the norm
+//   wait     the allreduce of the norm, mostly waiting for slower ranks
+// Times are per step, the largest over ranks for each part.
+//
+// A single launch sweeps the rank counts, running each on the first ranks
+// of MPI_COMM_WORLD while the others sleep, and a few processor grids for
+// each: balanced, and slabs along the first and the last dimension. Weak
+// scaling keeps n^3 points per rank, strong scaling N^3 points overall,
+// skipping grids that do not divide N.
+//
+// Usage: mpirun -np P --oversubscribe bench_scaling [options], with options
+//   --nprocs    1,2,4,8   rank counts, powers of two up to P by default
+//   --weak      48        local size n, 0 to skip weak scaling
+//   --strong    96        global size N, 0 to skip strong scaling
+//   --steps     20        timed steps, after 2 untimed ones
+//   --json      file      write the results as JSON
+//   --baseline  file      compare against the results of a previous run
+//   --tolerance 0.25      relative slowdown allowed against the baseline
+// The exit code is non zero if any case is slower than its baseline.
+
+// ===================================================================== //
+// comma separated list of integers
+static std::vector<int> split(const std::string& list) {
+    std::vector<int> out;
+    size_t start = 0;
+    while (true) {
+        const size_t end = list.find(',', start);
+        out.push_back(std::atoi(list.substr(start, end - start).c_str()));
+        if (end == std::string::npos)
+            return out;
+        start = end + 1;
+    }
+}
+
+// ===================================================================== //
+// timings of one case
+struct Result {
+    std::string    mode; // "weak" or "strong"
+    int          nprocs;
+    std::string    grid; // e.g. "2x2x2"
+    int            size; // local size for weak scaling, global for strong
+    double         step; // seconds per step, slowest rank
+    double      compute;
+    double         comm;
+    double         wait;
+    double   efficiency; // against the case on one rank, 0 if not run
+
+    // key identifying the case across runs
+    std::string key() const {
+        return mode + " " + std::to_string(nprocs) + " " + grid + " " + std::to_string(size);
+    }
+};
+
+// ===================================================================== //
+// JSON output, one case per line, and the matching minimal reader
+static std::string to_json(const Result& r) {
+    char line[512];
+    std::snprintf(line, sizeof(line),
+                  "{\"mode\": \"%s\", \"nprocs\": %d, \"grid\": \"%s\", \"size\": %d, "
+                  "\"step\": %.6e, \"compute\": %.6e, \"comm\": %.6e, \"wait\": %.6e, "
+                  "\"efficiency\": %.4f}",
+                  r.mode.c_str(), r.nprocs, r.grid.c_str(), r.size,
+                  r.step, r.compute, r.comm, r.wait, r.efficiency);
+    return line;
+}
+
+// value of a field in a line of to_json, without quotes
+static std::string field(const std::string& line, const std::string& name) {
+    size_t start = line.find("\"" + name + "\": ");
+    if (start == std::string::npos)
+        return "";
+    start += name.size() + 4;
+    if (line[start] == '"')
+        return line.substr(start + 1, line.find('"', start + 1) - start - 1);
+    return line.substr(start, line.find_first_of(",}", start) - start);
+}
+
+static std::map<std::string, Result> read_baseline(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file)
+        throw std::runtime_error("cannot open file " + filename);
+    std::map<std::string, Result> results;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (field(line, "mode").empty())
+            continue;
+        Result r = {field(line, "mode"), std::atoi(field(line, "nprocs").c_str()),
+                    field(line, "grid"), std::atoi(field(line, "size").c_str()),
+                    std::atof(field(line, "step").c_str()),
+                    std::atof(field(line, "compute").c_str()),
+                    std::atof(field(line, "comm").c_str()),
+                    std::atof(field(line, "wait").c_str()),
+                    std::atof(field(line, "efficiency").c_str())};
+        results[r.key()] = r;
+    }
+    return results;
+}
+
+// ===================================================================== //
+// grids of p ranks: balanced, and slabs along the first and last dimension
+static std::vector<std::array<int, 3>> grids(int p) {
+    std::array<int, 3> balanced = {0, 0, 0};
+    MPI_Dims_create(p, 3, balanced.data());
+    std::vector<std::array<int, 3>> out = {balanced, {p, 1, 1}, {1, 1, p}};
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+// ===================================================================== //
+// run the proxy app on the ranks of comm
+static Result proxy(MPI_Comm comm, const std::string& mode, const std::array<int, 3>& grid,
+                    int size, int nsteps) {
+    std::array<int, 3> array_size;
+    for (size_t dim = 0; dim != 3; dim++)
+        array_size[dim] = mode == "weak" ? size*grid[dim] : size;
+
+    DArrays::DArrayLayout<3> layout(comm, grid, {true, true, true});
+    DArrays::DArray<double, 3> u(layout, array_size, {1, 1, 1}, {1, 1, 1});
+    DArrays::DArray<double, 3> v(layout, array_size, {1, 1, 1}, {1, 1, 1});
+    for (auto [i, j, k] : u.indices())
+        u(i, j, k) = i + j + k;
+    const auto stencil = DArrays::laplacian_7pt<double>();
+
+    // time of each part on this rank
+    std::array<double, 4> t = {0, 0, 0, 0};
+    for (int step = 0; step != nsteps + 2; step++) {
+        if (step == 2) {
+            MPI_Barrier(comm);
+            t = {0, 0, 0, MPI_Wtime()};
+        }
+        double t0 = MPI_Wtime();
+        u.swap_halo();
+        double t1 = MPI_Wtime();
+        DArrays::apply_stencil(v, u, stencil);
+        const double local = DArrays::local_sumsq(v);
+        double t2 = MPI_Wtime();
+        double norm;
+        MPI_Allreduce(&local, &norm, 1, MPI_DOUBLE, MPI_SUM, comm);
+        double t3 = MPI_Wtime();
+        t[0] += t2 - t1;
+        t[1] += t1 - t0;
+        t[2] += t3 - t2;
+    }
+    t[3] = MPI_Wtime() - t[3];
+    MPI_Allreduce(MPI_IN_PLACE, t.data(), 4, MPI_DOUBLE, MPI_MAX, comm);
+
+    std::string shape = std::to_string(grid[0]) + "x" + std::to_string(grid[1])
+                      + "x" + std::to_string(grid[2]);
+    return {mode, layout.nprocs(), shape, size,
+            t[3]/nsteps, t[0]/nsteps, t[1]/nsteps, t[2]/nsteps, 0};
+}
+
+int main (int argc, char* argv[]) {
+
+    DArrays::MPI::Initialize();
+    int status = 0;
+    {
+        int rank, nprocs;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+        std::vector<int> counts;
+        for (int p = 1; p <= nprocs; p *= 2)
+            counts.push_back(p);
+        int weak = 48, strong = 96, nsteps = 20;
+        double tolerance = 0.25;
+        std::string json, baseline;
+
+        for (int n = 1; n + 1 < argc; n += 2) {
+            const std::string key = argv[n], value = argv[n + 1];
+            if      (key == "--nprocs")    counts    = split(value);
+            else if (key == "--weak")      weak      = std::atoi(value.c_str());
+            else if (key == "--strong")    strong    = std::atoi(value.c_str());
+            else if (key == "--steps")     nsteps    = std::atoi(value.c_str());
+            else if (key == "--json")      json      = value;
+            else if (key == "--baseline")  baseline  = value;
+            else if (key == "--tolerance") tolerance = std::atof(value.c_str());
+            else throw std::invalid_argument("unknown option " + key);
+        }
+        for (int p : counts)
+            if (p < 1 or p > nprocs)
+                throw std::invalid_argument("rank counts must be between 1 and " + std::to_string(nprocs));
+
+        if (rank == 0)
+            std::printf("%-6s %6s %-10s %5s %12s %12s %12s %12s %10s\n", "mode", "nprocs", "grid",
+                        "size", "step [ms]", "compute [ms]", "comm [ms]", "wait [ms]", "efficiency");
+
+        std::vector<Result> results;
+        for (std::string mode : {"weak", "strong"}) {
+            const int size = mode == "weak" ? weak : strong;
+            if (size == 0)
+                continue;
+            double t_one = 0;
+            for (int p : counts) {
+                MPI_Comm comm;
+                MPI_Comm_split(MPI_COMM_WORLD, rank < p ? 0 : MPI_UNDEFINED, rank, &comm);
+                for (const auto& grid : grids(p)) {
+                    bool divides = true;
+                    for (int g : grid)
+                        divides = divides and (mode == "weak" or size % g == 0);
+                    if (!divides or (mode == "strong" and size/std::max({grid[0], grid[1], grid[2]}) < 2))
+                        continue;
+
+                    Result r;
+                    if (comm != MPI_COMM_NULL)
+                        r = proxy(comm, mode, grid, size, nsteps);
+
+                    // idle ranks sleep rather than spin, to leave the cores
+                    // to the running ones when oversubscribed
+                    MPI_Request request;
+                    MPI_Ibarrier(MPI_COMM_WORLD, &request);
+                    int done = comm != MPI_COMM_NULL;
+                    if (done)
+                        MPI_Wait(&request, MPI_STATUS_IGNORE);
+                    while (!done) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                        MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+                    }
+                    if (rank != 0)
+                        continue;
+
+                    if (p == 1 and t_one == 0)
+                        t_one = r.step;
+                    if (t_one > 0)
+                        r.efficiency = mode == "weak" ? t_one/r.step : t_one/(p*r.step);
+                    results.push_back(r);
+                    std::printf("%-6s %6d %-10s %5d %12.3f %12.3f %12.3f %12.3f %10.2f\n",
+                                r.mode.c_str(), r.nprocs, r.grid.c_str(), r.size, 1e3*r.step,
+                                1e3*r.compute, 1e3*r.comm, 1e3*r.wait, r.efficiency);
+                }
+                if (comm != MPI_COMM_NULL)
+                    MPI_Comm_free(&comm);
+            }
+        }
+
+        if (rank == 0 and !json.empty()) {
+            std::ofstream file(json);
+            if (!file)
+                throw std::runtime_error("cannot open file " + json);
+            file << "{\n  \"benchmark\": \"scaling\",\n  \"results\": [\n";
+            for (size_t n = 0; n != results.size(); n++)
+                file << "    " << to_json(results[n]) << (n + 1 != results.size() ? ",\n" : "\n");
+            file << "  ]\n}\n";
+        }
+
+        if (rank == 0 and !baseline.empty()) {
+            const auto reference = read_baseline(baseline);
+            std::printf("\ncomparison with %s, tolerance %.0f%%\n", baseline.c_str(), 100*tolerance);
+            for (const auto& r : results) {
+                const auto it = reference.find(r.key());
+                if (it == reference.end()) {
+                    std::printf("%-30s not in baseline\n", r.key().c_str());
+                    continue;
+                }
+                const double ratio = r.step/it->second.step;
+                const bool   slow  = ratio > 1 + tolerance;
+                std::printf("%-30s %8.3f ms vs %8.3f ms  %+7.1f%%  %s\n", r.key().c_str(),
+                            1e3*r.step, 1e3*it->second.step, 100*(ratio - 1),
+                            slow ? "REGRESSION" : "ok");
+                status = status or slow;
+            }
+        }
+        MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+    DArrays::MPI::Finalize();
+
+    return status;
+}
@@ -0,0 +1,70 @@
+#include "DArrays.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <mpi.h>
+
+// Effective all-to-all bandwidth of the slab transpose of an N^3 array of
+// doubles, from slabs along x to slabs along y, blocking and non-blocking.
+// Usage: mpirun -np P bench_transpose [N [nreps]], with N a multiple of P.
+int main (int argc, char* argv[]) {
+
+    DArrays::MPI::Initialize();
+    {
+        const int N     = argc > 1 ? std::atoi(argv[1]) : 128;
+        const int nreps = argc > 2 ? std::atoi(argv[2]) : 20;
+
+        int nprocs;
+        MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+        std::array<int, 3> is_periodic = {false, false, false};
+        DArrays::DArrayLayout<3> layout_x(MPI_COMM_WORLD, {nprocs, 1, 1}, is_periodic);
+        DArrays::DArrayLayout<3> layout_y(MPI_COMM_WORLD, {1, nprocs, 1}, is_periodic);
+
+        DArrays::DArray<double, 3> X(layout_x, {N, N, N}, {1, 1, 1}, {1, 1, 1});
+        DArrays::DArray<double, 3> Y(layout_y, {N, N, N}, {1, 1, 1}, {1, 1, 1});
+        for (auto [i, j, k] : X.indices())
+            X(i, j, k) = i + j + k;
+
+        DArrays::SlabTranspose<double, 3> plan(Y, X);
+
+        // bytes leaving each rank, i.e. all but the block it keeps
+        const double bytes = double(N)*N*N/nprocs*(nprocs - 1)/nprocs*sizeof(double);
+
+        for (auto blocking : {true, false}) {
+            std::vector<double> times;
+            for (int n = 0; n != nreps + 1; n++) {
+                MPI_Barrier(MPI_COMM_WORLD);
+                double t0 = MPI_Wtime();
+                if (blocking) {
+                    plan.execute();
+                } else {
+                    plan.start();
+                    plan.wait();
+                }
+                double t = MPI_Wtime() - t0;
+
+                // slowest rank, skipping the first, warm up, repetition
+                MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+                if (n > 0)
+                    times.push_back(t);
+            }
+            std::sort(times.begin(), times.end());
+
+            if (layout_x.rank() == 0) {
+                const double best   = times.front();
+                const double median = times[times.size()/2];
+                std::printf("%-13s N = %5d, P = %4d: best %10.3f ms, median %10.3f ms, "
+                            "%8.3f GB/s per rank, %9.3f GB/s total\n",
+                            blocking ? "blocking" : "non-blocking", N, nprocs,
+                            1e3*best, 1e3*median,
+                            bytes/median/1e9, nprocs*bytes/median/1e9);
+            }
+        }
+    }
+    DArrays::MPI::Finalize();
+
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <array>
 #include <map>
+#include <tuple>
 #include <mpi.h>
 
 namespace DArrays {
@@ -23,9 +24,26 @@ inline void _checkdims(size_t dim, size_t NDIMS) {
 #include "iterators.hpp"
 #include "haloregionspec.hpp"
 #include "dlayout.hpp"
+#include "expressions.hpp"
+#include "cursor.hpp"
 #include "darray.hpp"
+#include "stencil.hpp"
+#include "threads.hpp"
 #include "subarray.hpp"
 #include "mpiwrapper.hpp"
+#include "haloswap.hpp"
+#include "tasks.hpp"
+#include "reductions.hpp"
+#include "multigrid.hpp"
+#include "transpose.hpp"
+#include "redistribute.hpp"
+#include "remote.hpp"
+#include "io.hpp"
+#include "checkpoint.hpp"
+#include "mmap.hpp"
+#include "compress.hpp"
+#include "insitu.hpp"
+#include "trace.hpp"
 
 // DEFAULT CONFIGURATION OPTIONS
 #ifndef DARRAY_ARRAY_CHECKBOUNDS
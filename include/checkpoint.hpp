@@ -0,0 +1,275 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <future>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Asynchronous checkpoints of a set of arrays. A checkpoint  //
+// copies the in-domain points into one of two staging        //
+// buffers and returns; a background I/O thread then writes   //
+// the copy to a single file, with the collective MPI-IO path //
+// of io.hpp, while the time loop keeps modifying the arrays. //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// CheckpointFuture: handle to a checkpoint being written. Any error met
+// while writing, e.g. failing to open the file, is thrown by wait().
+class CheckpointFuture {
+private:
+    std::shared_future<void> _future;
+
+public:
+    CheckpointFuture() = default;
+
+    explicit CheckpointFuture(std::shared_future<void> future)
+        : _future (std::move(future)) {}
+
+    // whether the handle refers to a checkpoint
+    inline bool valid() const {
+        return _future.valid();
+    }
+
+    // whether the file is complete, without blocking
+    inline bool test() const {
+        return _future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // block until the file is complete
+    inline void wait() const {
+        _future.get();
+    }
+};
+
+// ===================================================================== //
+// _IOThread: background thread running jobs in order, e.g. writing files
+// while the time loop goes on. Jobs making MPI calls need a communicator
+// of their own and MPI_THREAD_MULTIPLE: with a lower thread support level
+// jobs run when submitted.
+class _IOThread {
+private:
+    bool                                  _async; // whether MPI calls can be made by the thread
+    std::deque<std::function<void()>>      _jobs; // waiting for the thread
+    std::mutex                            _mutex;
+    std::condition_variable                  _cv;
+    bool                                   _stop;
+    std::thread                          _thread;
+
+    // run jobs in order, until stopped
+    void _loop() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [&] { return _stop or !_jobs.empty(); });
+                if (_jobs.empty())
+                    return;
+                job = std::move(_jobs.front());
+                _jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+public:
+    _IOThread()
+        : _stop (false) {
+            int provided;
+            MPI_Query_thread(&provided);
+            _async = provided == MPI_THREAD_MULTIPLE;
+            if (_async)
+                _thread = std::thread(&_IOThread::_loop, this);
+    }
+
+    ~_IOThread() {
+        join();
+    }
+
+    _IOThread(const _IOThread&) = delete;
+    _IOThread& operator = (const _IOThread&) = delete;
+
+    // ===================================================================== //
+    // queue a job, returning a handle to its completion. Exceptions thrown
+    // by the job are stored in the handle.
+    std::shared_future<void> submit(std::function<void()> f) {
+        auto promise = std::make_shared<std::promise<void>>();
+        auto done    = promise->get_future().share();
+        auto job = [f = std::move(f), promise] () {
+            try {
+                f();
+                promise->set_value();
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        };
+
+        if (_async) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _jobs.push_back(std::move(job));
+            }
+            _cv.notify_one();
+        } else {
+            job();
+        }
+        return done;
+    }
+
+    // ===================================================================== //
+    // run the queued jobs and stop the thread, e.g. before the buffers used
+    // by the jobs go away
+    void join() {
+        if (_thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _cv.notify_one();
+            _thread.join();
+        }
+    }
+};
+
+// ===================================================================== //
+// AsyncCheckpoint: writer of checkpoints of a fixed set of arrays, all on
+// the same communicator, one record per array in each file. All ranks
+// must call save() in the same order. The I/O thread makes MPI calls
+// on a communicator of its own, which requires MPI_THREAD_MULTIPLE, see
+// MPI::Initialize. With a lower thread support level, save() writes the
+// file before returning.
+template <typename T, size_t NDIMS>
+class AsyncCheckpoint {
+private:
+    // staging buffer, with the handle to the last checkpoint written from it
+    struct _Slot {
+        T*                         data = nullptr;
+        std::shared_future<void>   done;
+    };
+
+    std::vector<const DArray<T, NDIMS>*> _arrays;
+    size_t                               _nlocal; // in-domain points of all arrays on this rank
+    MPI_Comm                               _comm; // used by the I/O thread only
+    std::array<_Slot, 2>                  _slots;
+    int                                    _next; // slot of the next checkpoint
+    _IOThread                                _io;
+
+    // ===================================================================== //
+    // write the snapshot in a staging buffer to a file
+    void _write(const T* data, const std::string& filename) const {
+        MPI_File file = _create_file(filename, _comm);
+        long offset = 0;
+        for (auto a : _arrays) {
+            const int count = std::accumulate(a->size().begin(), a->size().end(),
+                                              1, std::multiplies<int>());
+            offset = _write_record(file, offset, *a, data, count, MPI::mpi_type<T>());
+            data  += count;
+        }
+        MPI_File_close(&file);
+    }
+
+public:
+    // ===================================================================== //
+    // constructor from the arrays to be saved, which must outlive the writer
+    AsyncCheckpoint(const std::vector<const DArray<T, NDIMS>*>& arrays)
+        : _arrays (arrays)
+        , _nlocal (0)
+        , _comm   (MPI_COMM_NULL)
+        , _next   (0) {
+            if (arrays.empty())
+                throw std::invalid_argument("no arrays to checkpoint");
+            for (auto a : arrays) {
+                int result;
+                MPI_Comm_compare(a->layout().communicator(),
+                                 arrays.front()->layout().communicator(), &result);
+                if (result != MPI_IDENT and result != MPI_CONGRUENT)
+                    throw std::invalid_argument("arrays must be on the same communicator");
+                _nlocal += std::accumulate(a->size().begin(), a->size().end(),
+                                           size_t(1), std::multiplies<size_t>());
+            }
+
+            MPI_Comm_dup(arrays.front()->layout().communicator(), &_comm);
+            for (auto& slot : _slots)
+                MPI_Alloc_mem(_nlocal*sizeof(T), MPI_INFO_NULL, &slot.data);
+    }
+
+    // ===================================================================== //
+    // checkpoints in progress complete before the buffers go away
+    ~AsyncCheckpoint() {
+        _io.join();
+        for (auto& slot : _slots)
+            MPI_Free_mem(slot.data);
+        MPI_Comm_free(&_comm);
+    }
+
+    AsyncCheckpoint(const AsyncCheckpoint&) = delete;
+    AsyncCheckpoint& operator = (const AsyncCheckpoint&) = delete;
+
+    // ===================================================================== //
+    // snapshot the arrays and write them to a file in the background. The
+    // arrays can be modified as soon as this returns. This blocks if both
+    // staging buffers hold checkpoints that are still being written.
+    CheckpointFuture save(const std::string& filename) {
+        _Slot& slot = _slots[_next];
+        _next = 1 - _next;
+        if (slot.done.valid())
+            slot.done.wait();
+
+        T* dest = slot.data;
+        for (auto a : _arrays)
+            for (const auto& row : a->rows())
+                dest = std::copy(row.begin(), row.end(), dest);
+
+        slot.done = _io.submit([this, data = slot.data, filename] () {
+            _write(data, filename);
+        });
+        return CheckpointFuture(slot.done);
+    }
+
+    // ===================================================================== //
+    // block until all checkpoints are written. Errors are only reported by
+    // the handles returned by save().
+    void wait() {
+        for (const auto& slot : _slots)
+            if (slot.done.valid())
+                slot.done.wait();
+    }
+};
+
+// ===================================================================== //
+// restart from a checkpoint, reading its records into the given arrays, in
+// the order they were saved. The arrays may be on any layout, e.g. on a
+// different number of ranks than that writing the file, as long as they
+// have the global size of the records: each rank reads the block it owns
+// through its own file view, with collective reads and no gather.
+template <typename T, size_t NDIMS>
+void restart(const std::string& filename, const std::vector<DArray<T, NDIMS>*>& arrays) {
+    if (arrays.empty())
+        throw std::invalid_argument("no arrays to restart");
+    const MPI_Comm comm = arrays.front()->layout().communicator();
+
+    // all ranks see the same headers, and throw together
+    const auto headers = read_headers(filename, comm);
+    if (headers.size() != arrays.size())
+        throw std::invalid_argument("number of arrays does not match checkpoint");
+    for (auto n : LinRange(arrays.size()))
+        headers[n].first.check(*arrays[n]);
+
+    MPI_File file;
+    if (MPI_File_open(comm, filename.c_str(), MPI_MODE_RDONLY,
+                      MPI_INFO_NULL, &file) != MPI_SUCCESS)
+        throw std::runtime_error("cannot open file " + filename);
+    for (auto n : LinRange(arrays.size()))
+        _read_record(file, headers[n].second, *arrays[n]);
+    MPI_File_close(&file);
+}
+
+}
@@ -0,0 +1,550 @@
+#pragma once
+#include <type_traits>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cmath>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Compressed output of DArrays. The local block of each rank //
+// is split into chunks, i.e. tiles of a given shape, which   //
+// are compressed independently on all ranks and then written //
+// to a single file with collective MPI-IO. An index of the   //
+// chunks follows the header, so that readers, on any layout, //
+// only read and decompress the chunks overlapping the boxes  //
+// they need.                                                 //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// how chunks are compressed
+enum class Codec : int32_t {
+    SHUFFLE  = 1, // lossless: bytes of the elements grouped by significance,
+                  // then LZ coded
+    QUANTIZE = 2  // lossy, floating point only: values rounded to multiples of
+                  // twice the tolerance, then delta, varint and LZ coded
+};
+
+// Smooth double precision fields of order one, in chunks of 16^3 points,
+// shrink 1.1 to 1.2 times with SHUFFLE: the low bytes of the mantissas are
+// noise to any lossless coder, and more is only gained on data repeating
+// itself, e.g. 2.5 times for a separable field. QUANTIZE shrinks them 8 to
+// 18 times for tolerances from 1e-6 to 1e-4, so that it is the codec to use
+// for several times less I/O.
+
+// ===================================================================== //
+// byte shuffle of n elements of given size: all first bytes, then all
+// second bytes and so on, so that the slowly varying bytes of smooth data
+// form runs and repeated sequences for the LZ coder
+inline void _shuffle(const unsigned char* in, size_t n, size_t elsize, unsigned char* out) {
+    for (size_t b = 0; b != elsize; b++)
+        for (size_t i = 0; i != n; i++)
+            out[b*n + i] = in[i*elsize + b];
+}
+
+inline void _unshuffle(const unsigned char* in, size_t n, size_t elsize, unsigned char* out) {
+    for (size_t b = 0; b != elsize; b++)
+        for (size_t i = 0; i != n; i++)
+            out[i*elsize + b] = in[b*n + i];
+}
+
+// ===================================================================== //
+// LZ77 coding in the manner of LZ4: a sequence of literal bytes, then a
+// match, i.e. a copy of earlier output, as
+//     token       literal length << 4 | (match length - 4), each 0 to 15
+//     [length]    literal length - 15 if 15 in the token, as 255, ..., < 255
+//     literals
+//     offset      2 bytes, little endian, back from the current output
+//     [length]    match length - 19 if 15 in the token, as above
+// The last sequence has literals only. Matches overlapping their own
+// output, with an offset of 1 say, encode runs of a byte.
+inline void _lz_encode(const unsigned char* in, size_t n, std::vector<unsigned char>& out) {
+    constexpr size_t min_match = 4;
+    constexpr size_t    window = 65535;
+    constexpr int     hashbits = 14;
+
+    // last position of each hashed 4 byte sequence
+    std::vector<int64_t> table(size_t(1) << hashbits, -1);
+    auto hash = [&](size_t i) {
+        uint32_t v;
+        std::memcpy(&v, in + i, sizeof(v));
+        return (v*2654435761u) >> (32 - hashbits);
+    };
+    auto put_length = [&](size_t len) {
+        for (; len >= 255; len -= 255)
+            out.push_back(255);
+        out.push_back(len);
+    };
+    auto put_sequence = [&](size_t literal, size_t nliteral, size_t offset, size_t match) {
+        const size_t extra = match != 0 ? match - min_match : 0;
+        out.push_back(std::min<size_t>(nliteral, 15) << 4 | std::min<size_t>(extra, 15));
+        if (nliteral >= 15)
+            put_length(nliteral - 15);
+        out.insert(out.end(), in + literal, in + literal + nliteral);
+        if (match != 0) {
+            out.push_back(offset & 0xff);
+            out.push_back(offset >> 8);
+            if (extra >= 15)
+                put_length(extra - 15);
+        }
+    };
+
+    size_t i = 0, literal = 0; // start of the pending literal bytes
+    while (i + min_match <= n) {
+        const auto    h     = hash(i);
+        const int64_t match = table[h];
+        table[h] = i;
+        if (match < 0 or i - match > window or std::memcmp(in + match, in + i, min_match) != 0) {
+            i++;
+            continue;
+        }
+        size_t len = min_match;
+        while (i + len != n and in[match + len] == in[i + len])
+            len++;
+        put_sequence(literal, i - literal, i - match, len);
+        for (size_t j = i + 1; j != i + len and j + min_match <= n; j++)
+            table[hash(j)] = j;
+        i      += len;
+        literal = i;
+    }
+    put_sequence(literal, n - literal, 0, 0);
+}
+
+inline void _lz_decode(const unsigned char* in, size_t nin, unsigned char* out, size_t nout) {
+    size_t i = 0, o = 0;
+    auto get_length = [&](size_t len) {
+        if (len == 15) {
+            unsigned char c;
+            do {
+                if (i == nin)
+                    throw std::runtime_error("corrupt compressed chunk");
+                c    = in[i++];
+                len += c;
+            } while (c == 255);
+        }
+        return len;
+    };
+    while (i != nin) {
+        const unsigned token    = in[i++];
+        const size_t   nliteral = get_length(token >> 4);
+        if (nliteral > nin - i or nliteral > nout - o)
+            throw std::runtime_error("corrupt compressed chunk");
+        std::memcpy(out + o, in + i, nliteral);
+        i += nliteral;
+        o += nliteral;
+        if (i == nin)
+            break;
+
+        if (nin - i < 2)
+            throw std::runtime_error("corrupt compressed chunk");
+        const size_t offset = in[i] | in[i + 1] << 8;
+        i += 2;
+        const size_t match = get_length(token & 15) + 4;
+        if (offset == 0 or offset > o or match > nout - o)
+            throw std::runtime_error("corrupt compressed chunk");
+        for (size_t m = 0; m != match; m++, o++)
+            out[o] = out[o - offset];
+    }
+    if (o != nout)
+        throw std::runtime_error("corrupt compressed chunk");
+}
+
+// ===================================================================== //
+// compress and decompress the n values of a chunk
+template <typename T>
+std::vector<unsigned char> _compress_chunk(const T* values, size_t n, Codec codec, double tolerance) {
+    std::vector<unsigned char> bytes, out;
+    if (codec == Codec::SHUFFLE) {
+        bytes.resize(n*sizeof(T));
+        _shuffle(reinterpret_cast<const unsigned char*>(values), n, sizeof(T), bytes.data());
+    } else if constexpr (std::is_floating_point_v<T>) {
+        // quantised values, differences with the previous one, zigzag and
+        // LEB128 varint encoded; their number of bytes is stored before the
+        // LZ coded bytes
+        int64_t previous = 0;
+        for (size_t i = 0; i != n; i++) {
+            const double q = std::round(values[i]/(2*tolerance));
+            if (!(std::abs(q) < 0x1p52))
+                throw std::invalid_argument("value out of range for the tolerance");
+            const int64_t  d = static_cast<int64_t>(q) - previous;
+            uint64_t       z = (static_cast<uint64_t>(d) << 1) ^ static_cast<uint64_t>(d >> 63);
+            previous = static_cast<int64_t>(q);
+            do {
+                bytes.push_back((z & 0x7f) | (z > 0x7f ? 0x80 : 0));
+                z >>= 7;
+            } while (z != 0);
+        }
+        const uint64_t nbytes = bytes.size();
+        out.resize(sizeof(nbytes));
+        std::memcpy(out.data(), &nbytes, sizeof(nbytes));
+    } else {
+        throw std::invalid_argument("lossy compression needs floating point elements");
+    }
+    _lz_encode(bytes.data(), bytes.size(), out);
+    return out;
+}
+
+template <typename T>
+void _decompress_chunk(const unsigned char* in, size_t nin, Codec codec, double tolerance,
+                       T* values, size_t n) {
+    if (codec == Codec::SHUFFLE) {
+        std::vector<unsigned char> bytes(n*sizeof(T));
+        _lz_decode(in, nin, bytes.data(), bytes.size());
+        _unshuffle(bytes.data(), n, sizeof(T), reinterpret_cast<unsigned char*>(values));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        uint64_t nbytes;
+        if (nin < sizeof(nbytes))
+            throw std::runtime_error("corrupt compressed chunk");
+        std::memcpy(&nbytes, in, sizeof(nbytes));
+        if (nbytes > 10*n)
+            throw std::runtime_error("corrupt compressed chunk");
+        std::vector<unsigned char> bytes(nbytes);
+        _lz_decode(in + sizeof(nbytes), nin - sizeof(nbytes), bytes.data(), bytes.size());
+
+        int64_t previous = 0;
+        size_t  b = 0;
+        for (size_t i = 0; i != n; i++) {
+            uint64_t z = 0;
+            for (int shift = 0; ; shift += 7) {
+                if (b == bytes.size())
+                    throw std::runtime_error("corrupt compressed chunk");
+                z |= static_cast<uint64_t>(bytes[b] & 0x7f) << shift;
+                if ((bytes[b++] & 0x80) == 0)
+                    break;
+            }
+            previous += static_cast<int64_t>(z >> 1) ^ -static_cast<int64_t>(z & 1);
+            values[i] = static_cast<T>(previous*2*tolerance);
+        }
+    } else {
+        throw std::invalid_argument("lossy compression needs floating point elements");
+    }
+}
+
+// ===================================================================== //
+// compression parameters, stored after the FileHeader, and entry of the
+// chunk index, which starts at FileHeader::data_offset
+struct CompressionInfo {
+    Codec                        codec;
+    int32_t                    padding;
+    double                   tolerance; // largest error of the lossy codec
+    int64_t                    nchunks;
+    int64_t                 data_start; // first byte of the chunk data
+};
+
+struct ChunkEntry {
+    int64_t origin[FileHeader::max_dims]; // global index of the first point
+    int64_t   size[FileHeader::max_dims];
+    int64_t                        offset; // from the start of the file
+    int64_t                        nbytes; // compressed size
+};
+
+// ===================================================================== //
+// read nbytes at offset, returning whether all of them could be read
+inline bool _read_exactly(MPI_File file, MPI_Offset offset, void* buffer, long nbytes) {
+    MPI_Status status;
+    int count = 0;
+    if (MPI_File_read_at(file, offset, buffer, nbytes, MPI_BYTE, &status) != MPI_SUCCESS)
+        return false;
+    MPI_Get_count(&status, MPI_BYTE, &count);
+    return count == nbytes;
+}
+
+// ===================================================================== //
+// header, compression parameters and index of a compressed file, read by
+// the first rank of comm and broadcast, so that all ranks throw together
+// on files that are not compressed DArray files, or are cut short. Index
+// entries out of the global array or of the file count as cut short.
+inline void _read_index(const std::string& filename, MPI_Comm comm, FileHeader& header,
+                        CompressionInfo& info, std::vector<ChunkEntry>& index) {
+    MPI_File file;
+    if (MPI_File_open(comm, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+        throw std::runtime_error("cannot open file " + filename);
+
+    // 0 if valid, 1 if not a compressed file, 2 if truncated
+    int rank, status = 0;
+    MPI_Comm_rank(comm, &rank);
+    if (rank == 0) {
+        MPI_Offset size;
+        MPI_File_get_size(file, &size);
+        header = {};
+        info   = {};
+        if (!_read_exactly(file, 0, &header, sizeof(header)))
+            status = 1;
+        else if (std::strncmp(header.magic, "DARRAYZ", sizeof(header.magic)) != 0)
+            status = 1;
+        else if (!_read_exactly(file, sizeof(header), &info, sizeof(info)) or info.nchunks < 0
+                 or info.nchunks > size/static_cast<long>(sizeof(ChunkEntry)))
+            status = 2;
+        if (status == 0) {
+            index.resize(info.nchunks);
+            if (!_read_exactly(file, FileHeader::data_offset, index.data(),
+                               index.size()*sizeof(ChunkEntry)))
+                status = 2;
+        }
+        if (status == 0 and (header.ndims < 1 or header.ndims > FileHeader::max_dims))
+            status = 2;
+        for (const auto& entry : index) {
+            if (status != 0)
+                break;
+            for (auto dim : LinRange(header.ndims))
+                if (entry.origin[dim] < 0 or entry.size[dim] < 0
+                    or entry.origin[dim] + entry.size[dim] > header.shape[dim])
+                    status = 2;
+            if (entry.offset < 0 or entry.nbytes < 0 or entry.offset > size - entry.nbytes)
+                status = 2;
+        }
+    }
+    MPI_Bcast(&status, 1, MPI_INT, 0, comm);
+    if (status == 0) {
+        MPI_Bcast(&header, sizeof(header), MPI_BYTE, 0, comm);
+        MPI_Bcast(&info,   sizeof(info),   MPI_BYTE, 0, comm);
+        index.resize(info.nchunks);
+        MPI_Bcast(index.data(), index.size()*sizeof(ChunkEntry), MPI_BYTE, 0, comm);
+    }
+    MPI_File_close(&file);
+
+    if (status == 1)
+        throw std::invalid_argument("not a compressed DArray file");
+    if (status == 2)
+        throw std::runtime_error("truncated compressed file " + filename);
+}
+
+// ===================================================================== //
+// read the chunks of a compressed file overlapping a global box, copying
+// their points in the box to dest, e.g. the in-domain points of an array
+template <typename T, size_t NDIMS, typename DEST>
+void _read_box(MPI_File file, const CompressionInfo& info, const std::vector<ChunkEntry>& index,
+               const std::array<int, NDIMS>& origin, const std::array<int, NDIMS>& size,
+               DEST&& dest) {
+    std::vector<unsigned char> bytes;
+    std::vector<T>             values;
+    for (const auto& entry : index) {
+        std::array<int, NDIMS> lo, hi;
+        bool overlap = true;
+        for (auto dim : LinRange(NDIMS)) {
+            lo[dim] = std::max<int>(origin[dim], entry.origin[dim]);
+            hi[dim] = std::min<int>(origin[dim] + size[dim], entry.origin[dim] + entry.size[dim]);
+            overlap = overlap and lo[dim] < hi[dim];
+        }
+        if (!overlap)
+            continue;
+
+        size_t n = 1;
+        for (auto dim : LinRange(NDIMS))
+            n *= entry.size[dim];
+        bytes.resize(entry.nbytes);
+        values.resize(n);
+        if (!_read_exactly(file, entry.offset, bytes.data(), bytes.size()))
+            throw std::runtime_error("truncated compressed file");
+        _decompress_chunk(bytes.data(), bytes.size(), info.codec, info.tolerance, values.data(), n);
+
+        // points of the chunk in the box, by global index
+        std::array<int, NDIMS> box;
+        for (auto dim : LinRange(NDIMS))
+            box[dim] = hi[dim] - lo[dim];
+        for (const auto& point : IndexRange<NDIMS>(lo, box)) {
+            size_t offset = 0;
+            for (auto dim = NDIMS; dim-- > 0; )
+                offset = offset*entry.size[dim] + point[dim] - entry.origin[dim];
+            dest(point, values[offset]);
+        }
+    }
+}
+
+// ===================================================================== //
+// write the in-domain points of an array to a compressed file, in chunks
+// of given shape, at most the local size of the array. The tolerance is
+// the largest error of the lossy codec. Chunks are compressed with the
+// threads of pool, if given. All ranks of the layout must call this.
+template <typename T, size_t NDIMS>
+void write_compressed(const DArray<T, NDIMS>& a, const std::string& filename,
+                      const std::array<int, NDIMS>& chunk, Codec codec = Codec::SHUFFLE,
+                      double tolerance = 0, ThreadPool* pool = nullptr) {
+    if (codec == Codec::QUANTIZE and !std::is_floating_point_v<T>)
+        throw std::invalid_argument("lossy compression needs floating point elements");
+    if (codec == Codec::QUANTIZE and !(tolerance > 0))
+        throw std::invalid_argument("lossy compression needs a positive tolerance");
+    const MPI_Comm comm = a.layout().communicator();
+
+    // compress local chunks. Values out of range of the tolerance fail on
+    // some ranks only, so that all ranks throw together after compression.
+    const TileRange<NDIMS> tiles = a.tiles(chunk);
+    std::vector<Tile<NDIMS>> local;
+    for (const auto& tile : tiles)
+        local.push_back(tile);
+    std::vector<std::vector<unsigned char>> data(local.size());
+    std::atomic<int> failed(0);
+    auto compress = [&](int id, int nthreads) {
+        std::vector<T> values;
+        for (size_t c = id; c < local.size(); c += nthreads) {
+            values.clear();
+            auto size = local[c].size();
+            const int length = size[0];
+            size[0] = 1;
+            for (const auto& index : IndexRange<NDIMS>(local[c].origin(), size)) {
+                const T* row = a.cursor(index).ptr();
+                values.insert(values.end(), row, row + length);
+            }
+            try {
+                data[c] = _compress_chunk(values.data(), values.size(), codec, tolerance);
+            } catch (const std::invalid_argument&) {
+                failed = 1;
+            }
+        }
+    };
+    if (pool != nullptr)
+        pool->run([&](int id) { compress(id, pool->size()); });
+    else
+        compress(0, 1);
+
+    int any_failed = failed;
+    MPI_Allreduce(MPI_IN_PLACE, &any_failed, 1, MPI_INT, MPI_LOR, comm);
+    if (any_failed)
+        throw std::invalid_argument("value out of range for the tolerance");
+
+    // where the data of each rank goes
+    long nbytes = 0, before = 0;
+    for (const auto& bytes : data)
+        nbytes += bytes.size();
+    MPI_Exscan(&nbytes, &before, 1, MPI_LONG, MPI_SUM, comm);
+    if (a.layout().rank() == 0)
+        before = 0;
+
+    int nlocal = local.size();
+    std::vector<int> counts(a.layout().nprocs()), displs(a.layout().nprocs());
+    MPI_Allgather(&nlocal, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+    for (auto p : LinRange(1, a.layout().nprocs()))
+        displs[p] = displs[p-1] + counts[p-1];
+    const long nchunks    = displs.back() + counts.back();
+    const long data_start = FileHeader::data_offset + nchunks*sizeof(ChunkEntry);
+
+    std::vector<ChunkEntry> entries(nlocal);
+    const auto origin = a.origin();
+    long offset = data_start + before;
+    for (auto c : LinRange(nlocal)) {
+        ChunkEntry entry = {};
+        for (auto dim : LinRange(NDIMS)) {
+            entry.origin[dim] = origin[dim] + local[c].origin(dim);
+            entry.size[dim]   = local[c].size(dim);
+        }
+        entry.offset = offset;
+        entry.nbytes = data[c].size();
+        offset      += entry.nbytes;
+        entries[c]   = entry;
+    }
+
+    // the index is gathered on the first rank, which writes the headers
+    std::vector<ChunkEntry> index(a.layout().rank() == 0 ? nchunks : 0);
+    for (auto p : LinRange(a.layout().nprocs())) {
+        counts[p] *= sizeof(ChunkEntry);
+        displs[p] *= sizeof(ChunkEntry);
+    }
+    MPI_Gatherv(entries.data(), nlocal*sizeof(ChunkEntry), MPI_BYTE,
+                index.data(), counts.data(), displs.data(), MPI_BYTE, 0, comm);
+
+    MPI_File file = _create_file(filename, comm);
+    if (a.layout().rank() == 0) {
+        FileHeader header = FileHeader::of(a);
+        std::strncpy(header.magic, "DARRAYZ", sizeof(header.magic));
+        CompressionInfo info = {codec, 0, tolerance, nchunks, data_start};
+        MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+        MPI_File_write_at(file, sizeof(header), &info, sizeof(info), MPI_BYTE, MPI_STATUS_IGNORE);
+        MPI_File_write_at(file, FileHeader::data_offset, index.data(),
+                          index.size()*sizeof(ChunkEntry), MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+
+    std::vector<unsigned char> buffer;
+    buffer.reserve(nbytes);
+    for (const auto& bytes : data)
+        buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+    MPI_File_write_at_all(file, data_start + before, buffer.data(), buffer.size(),
+                          MPI_BYTE, MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+}
+
+// ===================================================================== //
+// read a compressed file into an array on any layout, each rank reading
+// and decompressing only the chunks overlapping its block. All ranks of
+// the layout must call this, and throw together on corrupt chunks.
+template <typename T, size_t NDIMS>
+void read_compressed(DArray<T, NDIMS>& a, const std::string& filename) {
+    const MPI_Comm comm = a.layout().communicator();
+
+    // all ranks see the same header, and throw together
+    FileHeader              header;
+    CompressionInfo         info;
+    std::vector<ChunkEntry> index;
+    _read_index(filename, comm, header, info, index);
+    header.check(a, "DARRAYZ");
+
+    MPI_File file;
+    if (MPI_File_open(comm, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+        throw std::runtime_error("cannot open file " + filename);
+
+    // chunks are read by some ranks only, so errors are agreed on before
+    // the collective close
+    int failed = 0;
+    try {
+        const auto origin = a.origin();
+        _read_box<T, NDIMS>(file, info, index, origin, a.size(),
+            [&](const std::array<int, NDIMS>& global, const T& value) {
+                *a.cursor(a.local_index(global)) = value;
+            });
+    } catch (const std::runtime_error&) {
+        failed = 1;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_LOR, comm);
+    MPI_File_close(&file);
+    if (failed)
+        throw std::runtime_error("corrupt compressed file " + filename);
+}
+
+// ===================================================================== //
+// read a box of the global array of a compressed file, by a rank on its
+// own, e.g. for post-processing. The box is returned in Fortran order.
+template <typename T, size_t NDIMS>
+std::vector<T> read_compressed_box(const std::string& filename,
+                                   const std::array<int, NDIMS>& origin,
+                                   const std::array<int, NDIMS>& size) {
+    FileHeader              header;
+    CompressionInfo         info;
+    std::vector<ChunkEntry> index;
+    _read_index(filename, MPI_COMM_SELF, header, info, index);
+    if (std::strncmp(header.dtype, dtype_name<T>(), sizeof(header.dtype)) != 0)
+        throw std::invalid_argument("element type does not match file");
+    if (header.ndims != static_cast<int32_t>(NDIMS))
+        throw std::invalid_argument("number of dimensions does not match file");
+    for (auto dim : LinRange(NDIMS))
+        if (origin[dim] < 0 or size[dim] < 0 or origin[dim] + size[dim] > header.shape[dim])
+            throw std::out_of_range("box out of the global array");
+
+    size_t n = 1;
+    for (auto dim : LinRange(NDIMS))
+        n *= size[dim];
+    std::vector<T> values(n);
+
+    MPI_File file;
+    if (MPI_File_open(MPI_COMM_SELF, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file)
+        != MPI_SUCCESS)
+        throw std::runtime_error("cannot open file " + filename);
+    try {
+        _read_box<T, NDIMS>(file, info, index, origin, size,
+            [&](const std::array<int, NDIMS>& global, const T& value) {
+                size_t offset = 0;
+                for (auto dim = NDIMS; dim-- > 0; )
+                    offset = offset*size[dim] + global[dim] - origin[dim];
+                values[offset] = value;
+            });
+    } catch (...) {
+        MPI_File_close(&file);
+        throw;
+    }
+    MPI_File_close(&file);
+    return values;
+}
+
+}
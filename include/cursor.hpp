@@ -0,0 +1,192 @@
+#pragma once
+#include <array>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Pointer-based access to DArray data. A Cursor points to an //
+// element and reaches its neighbours by constant offsets; a  //
+// Row is the contiguous run of in-domain points along        //
+// dimension 0. Both carry the memory strides of the array,   //
+// so that inner loops do no index arithmetic.                //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// memory offset of an index from the strides of a buffer
+template <size_t NDIMS>
+inline int _dot(const std::array<int, NDIMS>& index,
+                const std::array<int, NDIMS>& strides) {
+    int n = 0;
+    for (auto dim : LinRange(NDIMS))
+        n += index[dim]*strides[dim];
+    return n;
+}
+
+// ===================================================================== //
+// Cursor: pointer to an element, with access to its neighbours
+template <typename T, size_t NDIMS>
+class Cursor {
+private:
+    T*                         _ptr; // current element
+    std::array<int, NDIMS> _strides; // memory strides of the array
+
+    inline int _offset(size_t dim, int d) const {
+        return d*_strides[dim];
+    }
+
+    template <typename... OFFSETS>
+    inline int _offset(size_t dim, int d, OFFSETS... offsets) const {
+        return d*_strides[dim] + _offset(dim+1, offsets...);
+    }
+
+public:
+    Cursor(T* ptr, const std::array<int, NDIMS>& strides)
+        : _ptr     (ptr    )
+        , _strides (strides) {}
+
+    // ===================================================================== //
+    // current element
+    inline T& operator * () const {
+        return *_ptr;
+    }
+
+    inline T* ptr() const {
+        return _ptr;
+    }
+
+    // ===================================================================== //
+    // element at offset n along dimension DIM, e.g. c.at<0>(+1)
+    template <size_t DIM>
+    inline T& at(int n) const {
+        static_assert(DIM < NDIMS, "dimension out of range");
+        return _ptr[n*_strides[DIM]];
+    }
+
+    // ===================================================================== //
+    // element at an arbitrary offset, e.g. c(1, -1, 0)
+    template <typename... OFFSETS>
+    inline T& operator () (OFFSETS... offsets) const {
+        static_assert(sizeof...(OFFSETS) == NDIMS,
+                      "Number of offsets must match array dimension");
+        return _ptr[_offset(0, offsets...)];
+    }
+
+    // ===================================================================== //
+    // step along the contiguous dimension, or by n along dimension DIM
+    inline Cursor& operator ++ () { ++_ptr; return *this; }
+    inline Cursor& operator -- () { --_ptr; return *this; }
+
+    template <size_t DIM>
+    inline Cursor& move(int n) {
+        static_assert(DIM < NDIMS, "dimension out of range");
+        _ptr += n*_strides[DIM];
+        return *this;
+    }
+};
+
+// ===================================================================== //
+// Row: contiguous in-domain points along dimension 0, usable as a span
+template <typename T, size_t NDIMS>
+class Row {
+private:
+    T*                         _ptr; // first point of the row
+    int                       _size; // number of points
+    std::array<int, NDIMS> _strides; // memory strides of the array
+    std::array<int, NDIMS>   _index; // index of the first point
+
+public:
+    using value_type = T;
+
+    Row(T* ptr, int size,
+        const std::array<int, NDIMS>& strides,
+        const std::array<int, NDIMS>& index)
+        : _ptr     (ptr    )
+        , _size    (size   )
+        , _strides (strides)
+        , _index   (index  ) {}
+
+    // ===================================================================== //
+    // span interface
+    inline T*   data() const { return _ptr; }
+    inline T*  begin() const { return _ptr; }
+    inline T*    end() const { return _ptr + _size; }
+    inline int  size() const { return _size; }
+
+    inline T& operator [] (int i) const {
+        return _ptr[i];
+    }
+
+    // ===================================================================== //
+    // index of the first point of the row
+    inline const std::array<int, NDIMS>& index() const {
+        return _index;
+    }
+
+    // ===================================================================== //
+    // pointer to the first point of the row shifted by n along dimension DIM,
+    // e.g. row.at<1>(-1)[i] is the neighbour of row[i] at j - 1
+    template <size_t DIM>
+    inline T* at(int n) const {
+        static_assert(DIM < NDIMS, "dimension out of range");
+        return _ptr + n*_strides[DIM];
+    }
+
+    // ===================================================================== //
+    // cursor at the i-th point of the row
+    inline Cursor<T, NDIMS> cursor(int i = 0) const {
+        return Cursor<T, NDIMS>(_ptr + i, _strides);
+    }
+};
+
+// ===================================================================== //
+// RowRange: all the rows of in-domain points of an array
+template <typename T, size_t NDIMS>
+class RowRange {
+private:
+    T*                         _ptr; // element at index (0, 0, ...)
+    int                     _length; // length of the rows
+    std::array<int, NDIMS> _strides; // memory strides of the array
+    IndexRange<NDIMS>         _rows; // indices of the first point of each row
+
+    class _RowRangeIter {
+    private:
+        const RowRange&                                         _range;
+        decltype(std::declval<IndexRange<NDIMS>>().begin())     _iter;
+    public:
+        _RowRangeIter(const RowRange& range, decltype(_iter) iter)
+            : _range (range)
+            , _iter  (iter ) {}
+
+        inline Row<T, NDIMS> operator * () const {
+            const auto index = *_iter;
+            return Row<T, NDIMS>(_range._ptr + _dot(index, _range._strides),
+                                 _range._length, _range._strides, index);
+        }
+
+        inline _RowRangeIter& operator ++ () {
+            ++_iter;
+            return *this;
+        }
+
+        inline bool operator != (const _RowRangeIter& other) const {
+            return _iter != other._iter;
+        }
+    };
+
+    static std::array<int, NDIMS> _nrows(std::array<int, NDIMS> size) {
+        size[0] = 1;
+        return size;
+    }
+
+public:
+    RowRange(T* ptr, const std::array<int, NDIMS>& size, const std::array<int, NDIMS>& strides)
+        : _ptr     (ptr)
+        , _length  (size[0])
+        , _strides (strides)
+        , _rows    (_nrows(size)) {}
+
+    _RowRangeIter begin() const { return {*this, _rows.begin()}; }
+    _RowRangeIter   end() const { return {*this, _rows.end()};   }
+};
+
+}
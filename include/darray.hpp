@@ -1,44 +1,63 @@
 #pragma once
 #include "subarray.hpp"
 #include "mpiwrapper.hpp"
+#include <string>
+#include <memory>
 
 namespace DArrays {
 
 using namespace DArrays::Iterators;
 using namespace DArrays::MPI;
 
+// ===================================================================== //
+// allocator of the memory buffer of an array: returns storage for n
+// elements, released when the last copy of the pointer goes away. See
+// mmap.hpp for buffers mapped from files.
+template <typename T>
+using Allocator = std::function<std::shared_ptr<T>(size_t)>;
+
+template <typename T>
+inline std::shared_ptr<T> heap_allocator(size_t n) {
+    return std::shared_ptr<T>(new T[n], std::default_delete<T[]>());
+}
+
 // forward declaration
 template <typename T, size_t NDIMS> class SubArray;
+template <typename T, size_t NDIMS> class HaloSwap;
 
 // ===================================================================== //
 // DArray
 template <typename T, size_t NDIMS>
 class DArray {
 private:
+    friend class HaloSwap<T, NDIMS>;
+
     std::array<int, NDIMS>            _local_arr_size; // local array size
     std::array<int, NDIMS>              _raw_arr_size; // local array size, including halo points
     std::map<int, SubArray<T, NDIMS>>   _subarray_map; // map from integer to halo
+    std::map<int, SubArray<T, NDIMS>>    _colour_map; // same, for one colour only, filled on demand
     std::array<int, NDIMS>               _nhalo_right; // number of halo points on 'right' side (high index)
     std::array<int, NDIMS>                _array_size; // global array size
     std::array<int, NDIMS>                _nhalo_left; // number of halo points on 'left'  side (low index)
     DArrayLayout<NDIMS>                       _layout; // topologically-aware communicator object
+    std::shared_ptr<T>                        _buffer; // owner of the memory buffer
     T*                                          _data; // actual data
 
     // ===================================================================== //
     // indexing into linear memory buffer
     template<typename... INDICES>
-    inline size_t _tolinearindex(INDICES... indices) {
+    inline size_t _tolinearindex(INDICES... indices) const {
         return __tolinearindex(0, indices...);
     }
 
-    inline size_t __tolinearindex(size_t dim, int i) {
+    inline size_t __tolinearindex(size_t dim, int i) const {
         return i + _nhalo_left[dim];
     }
 
     template <typename... INDICES>
-    inline size_t __tolinearindex(size_t dim, int i, INDICES... indices)  {
+    inline size_t __tolinearindex(size_t dim, int i, INDICES... indices) const {
         return __tolinearindex(dim, i) + 
-            _local_arr_size[dim]*__tolinearindex(dim+1, indices...);
+            _raw_arr_size[dim]*__tolinearindex(dim+1, indices...);
     }
 
     // ===================================================================== //
@@ -64,9 +83,42 @@ private:
     }
 
     // ===================================================================== //
-    // index into the dictionary HaloRegionSpec->SubArray
+    // index into the dictionary HaloRegionSpec->SubArray. Regions other than
+    // those of the list of halo regions, e.g. the faces swapped by HaloSwap,
+    // are added on first use
     inline SubArray<T, NDIMS>& _get_subarray(HaloRegionSpec<NDIMS> spec, HaloIntent intent) {
-        return _subarray_map.find(spec.hash(intent))->second;
+        return _subarray_map.try_emplace(spec.hash(intent), *this, spec, intent).first->second;
+    }
+
+    inline SubArray<T, NDIMS>& _get_subarray(HaloRegionSpec<NDIMS> spec, HaloIntent intent, int parity) {
+        return _colour_map.try_emplace(2*spec.hash(intent) + parity,
+                                       *this, spec, intent, parity).first->second;
+    }
+
+    // ===================================================================== //
+    // parity of the sum of the local indices of the points of given colour
+    inline int _local_parity(Colour colour) const {
+        int parity = static_cast<int>(colour);
+        for (auto dim : LinRange(NDIMS))
+            parity += _layout.coords(dim)*_local_arr_size[dim];
+        return parity & 1;
+    }
+
+    // ===================================================================== //
+    // evaluate expression over the in-domain points, row by row along the
+    // contiguous dimension, and combine it with the current values using op
+    template <typename E, typename OP>
+    void _evaluate(const E& expr, OP op) {
+        if constexpr (!is_scalar<E>::value)
+            if (expr.size() != _local_arr_size)
+                throw std::invalid_argument("incompatible array sizes in expression");
+
+        for (const auto& row : rows()) {
+            T* __restrict__ out = row.data();
+            auto            val = expr.row(row.index());
+            for (int i = 0; i != row.size(); i++)
+                op(out[i], val[i]);
+        }
     }
 
     // Compute local array size along given dimension, given size of processor grid 
@@ -85,13 +137,15 @@ public:
     using value_type = T;
 
     // ===================================================================== //
-    // constructor/destructor
+    // constructor. The memory buffer, halos included, is obtained from the
+    // allocator, from the heap by default.
     DArray() = delete;
 
     DArray(DArrayLayout<NDIMS> layout, 
            std::array<int, NDIMS> array_size,
            std::array<int, NDIMS> nhalo_out, 
-           std::array<int, NDIMS> nhalo_in)
+           std::array<int, NDIMS> nhalo_in,
+           Allocator<T>           allocator = heap_allocator<T>)
         : _array_size (array_size ) 
         , _layout     (layout     ) {
             // define size of local array and number of left/right halo points
@@ -110,7 +164,8 @@ public:
                     throw std::invalid_argument("too many halo points for local array size");
 
             // allocate memory buffer
-            _data = new T[nelements()];
+            _buffer = allocator(nelements());
+            _data   = _buffer.get();
 
             // construct dictionary of the halo regions used for halo swap
             for (auto& spec : std::get<NDIMS>(_halospeclist))
@@ -119,9 +174,12 @@ public:
                                           SubArray<T, NDIMS>(*this, spec, intent));
     }
 
-    ~DArray() {
-        delete[] _data;
-    }
+    // ===================================================================== //
+    // arrays are not copied or moved: their halo regions refer back to them
+    // and their buffer may be shared with a mapped file, see mapped_file.
+    // Copy the values with operator = between arrays of the same layout.
+    DArray(const DArray&) = delete;
+    DArray(DArray&&)      = delete;
 
     // ===================================================================== //
     // indexing into linear memory buffer
@@ -138,6 +196,50 @@ public:
         return _data[_tolinearindex(indices...)];
     }
 
+    // ===================================================================== //
+    // offset of the element at the given index from the start of the buffer
+    inline size_t linear_index(const std::array<int, NDIMS>& index) const {
+        return std::apply([this](auto... indices) {
+            return _tolinearindex(indices...); }, index);
+    }
+
+    // ===================================================================== //
+    // assignment from expressions, evaluated over the in-domain points only.
+    // Shifted operands must not refer to the array being assigned to.
+    DArray& operator = (const DArray& other) {
+        _evaluate(_as_expr(other), [](T& out, const T& val) { out = val; });
+        return *this;
+    }
+
+    template <typename E,
+              typename ENABLER = std::enable_if_t< _is_operand_v<E> or std::is_arithmetic_v<E> >>
+    DArray& operator = (const E& expr) {
+        _evaluate(_as_expr(expr), [](T& out, const auto& val) { out = val; });
+        return *this;
+    }
+
+    template <typename E,
+              typename ENABLER = std::enable_if_t< _is_operand_v<E> or std::is_arithmetic_v<E> >>
+    DArray& operator += (const E& expr) {
+        _evaluate(_as_expr(expr), [](T& out, const auto& val) { out += val; });
+        return *this;
+    }
+
+    template <typename E,
+              typename ENABLER = std::enable_if_t< _is_operand_v<E> or std::is_arithmetic_v<E> >>
+    DArray& operator -= (const E& expr) {
+        _evaluate(_as_expr(expr), [](T& out, const auto& val) { out -= val; });
+        return *this;
+    }
+
+    // ===================================================================== //
+    // view of the in-domain points shifted by n along dimension DIM, for use
+    // in expressions, e.g. B = A.shift<0>(+1) - A.shift<0>(-1)
+    template <size_t DIM>
+    inline Terminal<T, NDIMS> shift(int n) const {
+        return _as_expr(*this).template shift<DIM>(n);
+    }
+
     // ===================================================================== //
     // raw data pointer
     inline value_type* data() const {
@@ -161,6 +263,50 @@ public:
         return IndexRange<NDIMS>(_local_arr_size);
     }
 
+    // iterator over the in-domain indices of one colour, see Colour
+    inline ColouredIndexRange<NDIMS> indices (Colour colour) const {
+        return ColouredIndexRange<NDIMS>(std::array<int, NDIMS>{}, _local_arr_size,
+                                         _local_parity(colour));
+    }
+
+    // ===================================================================== //
+    // rows of in-domain points along the contiguous dimension
+    inline RowRange<T, NDIMS> rows() {
+        return RowRange<T, NDIMS>(_data + linear_index({}), _local_arr_size, strides());
+    }
+
+    inline RowRange<const T, NDIMS> rows() const {
+        return RowRange<const T, NDIMS>(_data + linear_index({}), _local_arr_size, strides());
+    }
+
+    // ===================================================================== //
+    // row of in-domain points containing the given index
+    inline Row<T, NDIMS> row(std::array<int, NDIMS> index) {
+        index[0] = 0;
+        return Row<T, NDIMS>(_data + linear_index(index), _local_arr_size[0], strides(), index);
+    }
+
+    inline Row<const T, NDIMS> row(std::array<int, NDIMS> index) const {
+        index[0] = 0;
+        return Row<const T, NDIMS>(_data + linear_index(index), _local_arr_size[0], strides(), index);
+    }
+
+    // ===================================================================== //
+    // cursor at the given index
+    inline Cursor<T, NDIMS> cursor(const std::array<int, NDIMS>& index) {
+        return Cursor<T, NDIMS>(_data + linear_index(index), strides());
+    }
+
+    inline Cursor<const T, NDIMS> cursor(const std::array<int, NDIMS>& index) const {
+        return Cursor<const T, NDIMS>(_data + linear_index(index), strides());
+    }
+
+    // ===================================================================== //
+    // partition of the in-domain indices into tiles of given shape
+    inline TileRange<NDIMS> tiles (std::array<int, NDIMS> shape) const {
+        return TileRange<NDIMS>(_local_arr_size, shape);
+    }
+
     // ===================================================================== //
     // local array size
     inline const std::array<int, NDIMS>& size() const { 
@@ -174,6 +320,72 @@ public:
         return _local_arr_size[dim]; 
     }
 
+    // ===================================================================== //
+    // global array size
+    inline const std::array<int, NDIMS>& array_size() const {
+        return _array_size;
+    }
+
+    // ===================================================================== //
+    // global index of the local in-domain point at (0, 0, ...)
+    inline std::array<int, NDIMS> origin() const {
+        std::array<int, NDIMS> _origin;
+        for (auto dim : LinRange(NDIMS))
+            _origin[dim] = _layout.coords(dim)*_local_arr_size[dim];
+        return _origin;
+    }
+
+    // ===================================================================== //
+    // map between local and global indices. Local indices outside the
+    // in-domain points, e.g. in the halo, map to global indices of the
+    // neighbours, and may fall out of the global domain.
+    inline std::array<int, NDIMS> global_index(std::array<int, NDIMS> index) const {
+        for (auto dim : LinRange(NDIMS))
+            index[dim] += _layout.coords(dim)*_local_arr_size[dim];
+        return index;
+    }
+
+    inline std::array<int, NDIMS> local_index(std::array<int, NDIMS> index) const {
+        for (auto dim : LinRange(NDIMS))
+            index[dim] -= _layout.coords(dim)*_local_arr_size[dim];
+        return index;
+    }
+
+    // ===================================================================== //
+    // global index brought back into the global domain along the periodic
+    // dimensions. Throws if it is out of the domain along the others.
+    inline std::array<int, NDIMS> wrap_index(std::array<int, NDIMS> index) const {
+        for (auto dim : LinRange(NDIMS)) {
+            if (_layout.is_periodic(dim)) {
+                index[dim] %= _array_size[dim];
+                if (index[dim] < 0)
+                    index[dim] += _array_size[dim];
+            } else if (index[dim] < 0 or index[dim] >= _array_size[dim]) {
+                throw std::out_of_range("global index out of range");
+            }
+        }
+        return index;
+    }
+
+    // ===================================================================== //
+    // rank in the layout communicator owning a global index, see wrap_index
+    inline int owner(const std::array<int, NDIMS>& index) const {
+        const auto wrapped = wrap_index(index);
+        std::array<int, NDIMS> coords;
+        for (auto dim : LinRange(NDIMS))
+            coords[dim] = wrapped[dim] / _local_arr_size[dim];
+        return _layout.rank_of(coords);
+    }
+
+    // whether a global index is an in-domain point of this rank
+    inline bool is_local(const std::array<int, NDIMS>& index) const {
+        const auto local = local_index(index);
+        for (auto dim : LinRange(NDIMS))
+            if (local[dim] < 0 or local[dim] >= _local_arr_size[dim])
+                return false;
+        return true;
+    }
+
     // ===================================================================== //
     // number of halo points at a particular boundary  
     inline int nhalo_points(Boundary bnd, size_t dim) const { 
@@ -194,6 +406,16 @@ public:
         return _raw_arr_size; 
     }
     
+    // ===================================================================== //
+    // distance in memory between elements one index apart along each dimension
+    inline std::array<int, NDIMS> strides() const {
+        std::array<int, NDIMS> _strides;
+        _strides[0] = 1;
+        for (auto dim : LinRange(1, NDIMS))
+            _strides[dim] = _strides[dim-1]*_raw_arr_size[dim-1];
+        return _strides;
+    }
+
     // ===================================================================== //
     // size of memory buffer, including halo
     inline size_t nelements() const {
@@ -202,13 +424,53 @@ public:
     }
     
     // ===================================================================== //
-    // swap halo points with neighbours
+    // swap halo points with neighbours. Regions are swapped from the last
+    // dimension to the first, so that the WILDCARD regions also carry the
+    // corner points received in the previous steps
     void swap_halo() {
-        for (const auto& halo_spec : std::get<NDIMS>(_halospeclist))
+        TraceRegion region("swap_halo", "halo");
+        const auto& specs = std::get<NDIMS>(_halospeclist);
+        for (auto it = specs.rbegin(); it != specs.rend(); ++it) {
+            const auto& halo_spec = *it;
             sendrecv(_get_subarray(halo_spec, HaloIntent::SEND),           
                      _layout.rank_of_neighbour_at(halo_spec),
                      _get_subarray(opposite(halo_spec), HaloIntent::RECV), 
                      _layout.rank_of_neighbour_at(opposite(halo_spec)));
-    }    
+        }
+    }
+
+    // ===================================================================== //
+    // swap only the halo points of given colour, e.g. after updating that
+    // colour in a red-black smoother, sending half the data of swap_halo().
+    // Colours are consistent across periodic boundaries only if the number
+    // of global points is even along the periodic dimensions.
+    void swap_halo(Colour colour) {
+        for (auto dim : LinRange(NDIMS))
+            if (_layout.is_periodic(dim) and _array_size[dim] % 2 != 0)
+                throw std::invalid_argument("odd number of points along periodic dimension");
+
+        TraceRegion region("swap_halo (colour)", "halo");
+        const int parity = _local_parity(colour);
+        const auto& specs = std::get<NDIMS>(_halospeclist);
+        for (auto it = specs.rbegin(); it != specs.rend(); ++it) {
+            const auto& halo_spec = *it;
+            sendrecv(_get_subarray(halo_spec, HaloIntent::SEND, parity),
+                     _layout.rank_of_neighbour_at(halo_spec),
+                     _get_subarray(opposite(halo_spec), HaloIntent::RECV, parity),
+                     _layout.rank_of_neighbour_at(opposite(halo_spec)));
+        }
+    }
+
+    // ===================================================================== //
+    // save the in-domain points of the global array to a single file, or
+    // load them, with collective MPI-IO; see io.hpp for the file format.
+    // All ranks of the layout must call these.
+    void write(const std::string& filename) const {
+        _write_file(*this, filename);
+    }
+
+    void read(const std::string& filename) {
+        _read_file(*this, filename);
+    }
 };
 }
\ No newline at end of file
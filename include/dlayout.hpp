@@ -111,6 +111,38 @@ public:
         return _comm_rank;
     }
 
+    // ===================================================================== //
+    // cartesian coordinates of current processor in the grid
+    inline const std::array<int, NDIMS>& coords() const {
+        return _coords;
+    }
+
+    inline int coords(size_t dim) const {
+        #if DARRAY_LAYOUT_CHECKBOUNDS
+            _checkdims(dim, NDIMS);
+        #endif
+        return _coords[dim];
+    }
+
+    // ===================================================================== //
+    // rank of the processor at given coordinates in the grid, and back. The
+    // grid is not reordered, so ranks follow the row-major order of MPI.
+    inline int rank_of(const std::array<int, NDIMS>& coords) const {
+        int rank = 0;
+        for (auto dim : LinRange(NDIMS))
+            rank = rank*_size[dim] + coords[dim];
+        return rank;
+    }
+
+    inline std::array<int, NDIMS> coords_of(int rank) const {
+        std::array<int, NDIMS> coords;
+        for (auto dim = NDIMS; dim-- > 0; ) {
+            coords[dim] = rank % _size[dim];
+            rank       /= _size[dim];
+        }
+        return coords;
+    }
+
     // ===================================================================== //
     // whether this processor has a neighbour on given halo
     inline bool has_neighbour_at(const HaloRegionSpec<NDIMS>& halo) const {
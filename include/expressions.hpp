@@ -0,0 +1,241 @@
+#pragma once
+#include <type_traits>
+#include <functional>
+#include <array>
+
+namespace DArrays {
+
+// forward declaration
+template <typename T, size_t NDIMS> class DArray;
+
+////////////////////////////////////////////////////////////////
+// Lazy element-wise expressions over DArrays. An expression  //
+// is evaluated row by row, a row being the set of points     //
+// along the contiguous dimension 0, so that the assignment   //
+// C = a*A + B*B - D is a single pass with no temporaries.    //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// base class of all expression nodes, used for type dispatch only
+struct _ExprBase {};
+
+template <typename E>
+constexpr bool is_expression_v = std::is_base_of_v<_ExprBase, E>;
+
+template <typename T>
+struct is_darray { static const bool value = false; };
+
+template <typename T, size_t NDIMS>
+struct is_darray<DArray<T, NDIMS>> { static const bool value = true; };
+
+// ===================================================================== //
+// Terminal: view of the in-domain points of a DArray, possibly shifted
+// by a constant offset into the halo region
+template <typename T, size_t NDIMS>
+class Terminal : public _ExprBase {
+private:
+    const DArray<T, NDIMS>& _array; // referenced array
+    std::array<int, NDIMS>  _shift; // constant offset added to the indices
+
+    struct _Row {
+        const T* _ptr;
+        inline const T& operator [] (int i) const { return _ptr[i]; }
+    };
+
+public:
+    using value_type = T;
+
+    // ===================================================================== //
+    // constructor
+    Terminal(const DArray<T, NDIMS>& array, std::array<int, NDIMS> shift)
+        : _array (array)
+        , _shift (shift) {
+            // shifted points must fall within the halo region
+            for (auto dim : LinRange(NDIMS))
+                if (_shift[dim] < -_array.nhalo_points(Boundary::LEFT,  dim) or
+                    _shift[dim] >  _array.nhalo_points(Boundary::RIGHT, dim))
+                    throw std::out_of_range("shift larger than number of halo points");
+    }
+
+    // ===================================================================== //
+    // shift further along dimension DIM
+    template <size_t DIM>
+    inline Terminal shift(int n) const {
+        static_assert(DIM < NDIMS, "dimension out of range");
+        std::array<int, NDIMS> shift = _shift; shift[DIM] += n;
+        return Terminal(_array, shift);
+    }
+
+    // ===================================================================== //
+    // size of the domain over which the expression is defined
+    inline const std::array<int, NDIMS>& size() const {
+        return _array.size();
+    }
+
+    // ===================================================================== //
+    // accessor to the row starting at the given index
+    inline _Row row(std::array<int, NDIMS> index) const {
+        for (auto dim : LinRange(NDIMS))
+            index[dim] += _shift[dim];
+        return {_array.data() + _array.linear_index(index)};
+    }
+};
+
+// ===================================================================== //
+// Scalar: constant value broadcast over the domain
+template <typename T>
+class Scalar : public _ExprBase {
+private:
+    T _value;
+
+    struct _Row {
+        T _value;
+        inline T operator [] (int) const { return _value; }
+    };
+
+public:
+    using value_type = T;
+
+    Scalar(T value) : _value (value) {}
+
+    template <typename INDEX>
+    inline _Row row(const INDEX&) const {
+        return {_value};
+    }
+};
+
+template <typename T>
+struct is_scalar { static const bool value = false; };
+
+template <typename T>
+struct is_scalar<Scalar<T>> { static const bool value = true; };
+
+// ===================================================================== //
+// UnaryOp: element-wise function of one expression
+template <typename OP, typename E>
+class UnaryOp : public _ExprBase {
+private:
+    OP _op;
+    E   _e;
+
+    template <typename ROW>
+    struct _Row {
+        OP  _op;
+        ROW _e;
+        inline auto operator [] (int i) const { return _op(_e[i]); }
+    };
+
+public:
+    using value_type = typename E::value_type;
+
+    UnaryOp(OP op, const E& e) : _op (op), _e (e) {}
+
+    inline const auto& size() const {
+        return _e.size();
+    }
+
+    template <typename INDEX>
+    inline auto row(const INDEX& index) const {
+        return _Row<decltype(_e.row(index))>{_op, _e.row(index)};
+    }
+};
+
+// ===================================================================== //
+// BinaryOp: element-wise function of two expressions
+template <typename OP, typename L, typename R>
+class BinaryOp : public _ExprBase {
+private:
+    OP _op;
+    L   _l;
+    R   _r;
+
+    template <typename LROW, typename RROW>
+    struct _Row {
+        OP   _op;
+        LROW _l;
+        RROW _r;
+        inline auto operator [] (int i) const { return _op(_l[i], _r[i]); }
+    };
+
+public:
+    using value_type = std::common_type_t<typename L::value_type,
+                                          typename R::value_type>;
+
+    BinaryOp(OP op, const L& l, const R& r)
+        : _op (op)
+        , _l  (l )
+        , _r  (r ) {
+            if constexpr (!is_scalar<L>::value and !is_scalar<R>::value)
+                if (_l.size() != _r.size())
+                    throw std::invalid_argument("incompatible array sizes in expression");
+    }
+
+    // the scalar operand, if any, does not have a size
+    inline const auto& size() const {
+        if constexpr (is_scalar<L>::value)
+            return _r.size();
+        else
+            return _l.size();
+    }
+
+    template <typename INDEX>
+    inline auto row(const INDEX& index) const {
+        return _Row<decltype(_l.row(index)), decltype(_r.row(index))>{
+            _op, _l.row(index), _r.row(index)};
+    }
+};
+
+// ===================================================================== //
+// wrap DArrays and numbers into expression nodes
+template <typename T, size_t NDIMS>
+inline Terminal<T, NDIMS> _as_expr(const DArray<T, NDIMS>& a) {
+    return Terminal<T, NDIMS>(a, {0});
+}
+
+template <typename E,
+          typename ENABLER = std::enable_if_t< is_expression_v<E> >>
+inline const E& _as_expr(const E& e) {
+    return e;
+}
+
+template <typename S,
+          typename ENABLER = std::enable_if_t< std::is_arithmetic_v<S> >>
+inline Scalar<S> _as_expr(S s) {
+    return Scalar<S>(s);
+}
+
+// at least one operand must be an array or expression
+template <typename E>
+constexpr bool _is_operand_v = is_expression_v<E> or is_darray<E>::value;
+
+template <typename L, typename R>
+constexpr bool _is_operand_pair_v =
+    (_is_operand_v<L> and (_is_operand_v<R> or std::is_arithmetic_v<R>)) or
+    (_is_operand_v<R> and std::is_arithmetic_v<L>);
+
+// ===================================================================== //
+// arithmetic operators
+#define DARRAY_BINARY_OPERATOR(SYMBOL, FUNCTOR)                              \
+template <typename L, typename R,                                            \
+          typename ENABLER = std::enable_if_t< _is_operand_pair_v<L, R> >>   \
+inline auto operator SYMBOL (const L& l, const R& r) {                       \
+    auto _l = _as_expr(l);                                                   \
+    auto _r = _as_expr(r);                                                   \
+    return BinaryOp<FUNCTOR, decltype(_l), decltype(_r)>(FUNCTOR(), _l, _r); \
+}
+
+DARRAY_BINARY_OPERATOR(+, std::plus<>)
+DARRAY_BINARY_OPERATOR(-, std::minus<>)
+DARRAY_BINARY_OPERATOR(*, std::multiplies<>)
+DARRAY_BINARY_OPERATOR(/, std::divides<>)
+
+#undef DARRAY_BINARY_OPERATOR
+
+template <typename E,
+          typename ENABLER = std::enable_if_t< _is_operand_v<E> >>
+inline auto operator - (const E& e) {
+    auto _e = _as_expr(e);
+    return UnaryOp<std::negate<>, decltype(_e)>(std::negate<>(), _e);
+}
+
+}
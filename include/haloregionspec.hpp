@@ -20,6 +20,11 @@ struct is_boundary<Boundary> { static const bool value = true; };
 // tags for sending or receiving the halo region 
 enum class HaloIntent : int {SEND = -1, RECV = 1};
 
+// ===================================================================== //
+// colours of a red-black ordering: a point is RED if the sum of its
+// global indices is even, BLACK otherwise
+enum class Colour : int {RED = 0, BLACK = 1};
+
 
 // ===================================================================== //
 // HaloRegionSpec                     
@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+
+namespace DArrays {
+
+// ===================================================================== //
+// HaloSwap: non-blocking swap of the halo faces of a DArray, started at
+// construction. Faces can be used as soon as they are reported by test().
+// Since all faces are exchanged at once, they span the in-domain points
+// only along the other dimensions, CENTER rather than WILDCARD, so that no
+// region being sent overlaps one being received. Corner points are thus
+// not updated, unlike with DArray::swap_halo: use this for stencils that
+// only read along the axes.
+template <typename T, size_t NDIMS>
+class HaloSwap {
+private:
+    DArray<T, NDIMS>&                 _array; // array being swapped
+    std::vector<HaloRegionSpec<NDIMS>> _faces; // halo regions, without corners
+    std::vector<MPI_Request>       _requests; // receives first, then sends
+    std::vector<int>                _indices; // buffer for MPI_Testsome
+    int                           _ncomplete; // number of completed requests
+
+public:
+    // ===================================================================== //
+    // constructor: post all receives, then all sends. Messages are tagged
+    // with the position of the region in the list of halo regions, to keep
+    // them apart when the same rank is neighbour on two sides.
+    HaloSwap(DArray<T, NDIMS>& array)
+        : _array     (array)
+        , _ncomplete (0) {
+            TraceRegion region("HaloSwap::post", "halo");
+            for (const auto& spec : std::get<NDIMS>(_halospeclist)) {
+                std::array<Boundary, NDIMS> face;
+                for (auto dim : LinRange(NDIMS))
+                    face[dim] = spec[dim] == Boundary::WILDCARD ? Boundary::CENTER : spec[dim];
+                _faces.emplace_back(face);
+            }
+            for (auto i : LinRange(_faces.size()))
+                _requests.push_back(
+                    irecv(_array._get_subarray(opposite(_faces[i]), HaloIntent::RECV),
+                          _array.layout().rank_of_neighbour_at(opposite(_faces[i])), i));
+            for (auto i : LinRange(_faces.size()))
+                _requests.push_back(
+                    isend(_array._get_subarray(_faces[i], HaloIntent::SEND),
+                          _array.layout().rank_of_neighbour_at(_faces[i]), i));
+            _indices.resize(_requests.size());
+    }
+
+    // ===================================================================== //
+    // all requests must be completed before the array can be used
+    ~HaloSwap() {
+        wait();
+    }
+
+    HaloSwap(const HaloSwap&) = delete;
+    HaloSwap& operator = (const HaloSwap&) = delete;
+
+    // ===================================================================== //
+    // halo faces received since the previous call
+    std::vector<HaloRegionSpec<NDIMS>> test() {
+        std::vector<HaloRegionSpec<NDIMS>> received;
+        if (done())
+            return received;
+
+        int outcount;
+        MPI_Testsome(_requests.size(), _requests.data(),
+                     &outcount, _indices.data(), MPI_STATUSES_IGNORE);
+        if (outcount == MPI_UNDEFINED)
+            return received;
+
+        for (auto n : LinRange(outcount))
+            if (_indices[n] < static_cast<int>(_faces.size()))
+                received.push_back(opposite(_faces[_indices[n]]));
+        _ncomplete += outcount;
+        return received;
+    }
+
+    // ===================================================================== //
+    // whether all receives and sends have completed
+    inline bool done() const {
+        return _ncomplete == static_cast<int>(_requests.size());
+    }
+
+    // ===================================================================== //
+    // block until all receives and sends have completed
+    void wait() {
+        if (done())
+            return;
+        TraceRegion region("HaloSwap::wait", "halo");
+        MPI_Waitall(_requests.size(), _requests.data(), MPI_STATUSES_IGNORE);
+        _ncomplete = _requests.size();
+    }
+};
+
+}
@@ -0,0 +1,305 @@
+#pragma once
+#include <stdexcept>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// In-situ extraction of reduced output: planes, boxes, line  //
+// profiles and strided subsamples of the global array are    //
+// copied out of an array and streamed to a file, one record  //
+// of the io.hpp format per snapshot, by the background I/O   //
+// thread. Only the ranks owning selected points take part,   //
+// writing collectively or gathering to a single writer.      //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// every stride-th point of a box of the global array
+template <size_t NDIMS>
+struct Selection {
+    std::array<int, NDIMS> origin; // first global index
+    std::array<int, NDIMS>   size; // extent of the box
+    std::array<int, NDIMS> stride;
+
+    // number of points selected along each dimension
+    inline std::array<int, NDIMS> shape() const {
+        std::array<int, NDIMS> out;
+        for (auto dim : LinRange(NDIMS))
+            out[dim] = (size[dim] + stride[dim] - 1)/stride[dim];
+        return out;
+    }
+};
+
+// all points of a box, e.g. a line profile with size one but along a dimension
+template <size_t NDIMS>
+inline Selection<NDIMS> box(const std::array<int, NDIMS>& origin,
+                            const std::array<int, NDIMS>& size) {
+    Selection<NDIMS> selection = {origin, size, {}};
+    selection.stride.fill(1);
+    return selection;
+}
+
+// the plane of points at a given position along a dimension
+template <size_t NDIMS>
+inline Selection<NDIMS> plane(const std::array<int, NDIMS>& array_size, size_t dim, int position) {
+    Selection<NDIMS> selection = box(std::array<int, NDIMS>{}, array_size);
+    selection.origin[dim] = position;
+    selection.size[dim]   = 1;
+    return selection;
+}
+
+// every stride-th point of the whole array
+template <size_t NDIMS>
+inline Selection<NDIMS> subsample(const std::array<int, NDIMS>& array_size,
+                                  const std::array<int, NDIMS>& stride) {
+    return {std::array<int, NDIMS>{}, array_size, stride};
+}
+
+// ===================================================================== //
+// how the ranks owning selected points write them
+enum class OutputMode {
+    COLLECTIVE, // all of them, with collective MPI-IO
+    GATHER      // the first of them, after gathering the points, e.g. for
+                // small selections spread over many ranks
+};
+
+// ===================================================================== //
+// InSituStream: writer of the snapshots of a selection of the points of an
+// array to a file, one record per snapshot, in the order of push(). All
+// ranks of the layout must construct the stream, but only the ranks owning
+// selected points make MPI calls afterwards, on a communicator of their
+// own used by the I/O thread. Like AsyncCheckpoint, snapshots are written
+// in the background with MPI_THREAD_MULTIPLE, and before push() returns
+// otherwise.
+template <typename T, size_t NDIMS>
+class InSituStream {
+private:
+    const DArray<T, NDIMS>&           _array;
+    std::array<int, NDIMS>           _stride;
+    std::array<int, NDIMS>            _first; // local index of the first point of this rank
+    std::array<int, NDIMS>            _count; // selected points of this rank
+    std::array<int, NDIMS>           _offset; // position of the first point in the selection
+    FileHeader                       _header; // of each record
+    OutputMode                         _mode;
+    MPI_Comm                           _comm; // ranks owning points, MPI_COMM_NULL elsewhere
+    MPI_File                           _file;
+    long                           _nrecords; // snapshots pushed so far
+    std::vector<int>                  _boxes; // offset and count of each rank, on the writer
+    std::vector<T>                 _gathered; // points of all ranks, on the writer
+    std::array<std::vector<T>, 2>     _slots; // staging buffers
+    std::array<std::shared_future<void>, 2> _done; // last snapshot written from each slot
+    int                                _next; // slot of the next snapshot
+    _IOThread                            _io;
+
+    // ===================================================================== //
+    // number of points of this rank
+    inline size_t _npoints() const {
+        return std::accumulate(_count.begin(), _count.end(), size_t(1), std::multiplies<size_t>());
+    }
+
+    // ===================================================================== //
+    // write a snapshot as record n, from the I/O thread
+    void _write(const T* data, long n) {
+        int rank, nprocs;
+        MPI_Comm_rank(_comm, &rank);
+        MPI_Comm_size(_comm, &nprocs);
+        const long offset = n*_header.record_size();
+        const auto shape  = _header.array_size<NDIMS>();
+
+        // offsets are relative to the view, which may be that of another record
+        MPI_File_set_view(_file, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+        if (rank == 0)
+            MPI_File_write_at(_file, offset, &_header, sizeof(_header), MPI_BYTE, MPI_STATUS_IGNORE);
+
+        if (_mode == OutputMode::COLLECTIVE) {
+            MPI_Datatype filetype;
+            MPI_Type_create_subarray(NDIMS, shape.data(), _count.data(), _offset.data(),
+                                     MPI_ORDER_FORTRAN, MPI::mpi_type<T>(), &filetype);
+            MPI_Type_commit(&filetype);
+            MPI_File_set_view(_file, offset + FileHeader::data_offset, MPI::mpi_type<T>(),
+                              filetype, "native", MPI_INFO_NULL);
+            MPI_File_write_all(_file, data, _npoints(), MPI::mpi_type<T>(), MPI_STATUS_IGNORE);
+            MPI_Type_free(&filetype);
+            return;
+        }
+
+        // points of each rank one after the other on the writer
+        std::vector<int> counts(nprocs), displs(nprocs);
+        if (rank == 0)
+            for (auto p : LinRange(nprocs)) {
+                counts[p] = 1;
+                for (auto dim : LinRange(NDIMS))
+                    counts[p] *= _boxes[2*NDIMS*p + NDIMS + dim];
+                if (p > 0)
+                    displs[p] = displs[p-1] + counts[p-1];
+            }
+        std::vector<T> points(rank == 0 ? _gathered.size() : 0);
+        MPI_Gatherv(data, _npoints(), MPI::mpi_type<T>(),
+                    points.data(), counts.data(), displs.data(), MPI::mpi_type<T>(), 0, _comm);
+        if (rank != 0)
+            return;
+
+        for (auto p : LinRange(nprocs)) {
+            std::array<int, NDIMS> origin, count;
+            for (auto dim : LinRange(NDIMS)) {
+                origin[dim] = _boxes[2*NDIMS*p + dim];
+                count[dim]  = _boxes[2*NDIMS*p + NDIMS + dim];
+            }
+            const T* src = points.data() + displs[p];
+            for (const auto& index : IndexRange<NDIMS>(origin, count)) {
+                size_t linear = 0;
+                for (auto dim = NDIMS; dim-- > 0; )
+                    linear = linear*shape[dim] + index[dim];
+                _gathered[linear] = *src++;
+            }
+        }
+        MPI_File_write_at(_file, offset + FileHeader::data_offset, _gathered.data(),
+                          _gathered.size(), MPI::mpi_type<T>(), MPI_STATUS_IGNORE);
+    }
+
+public:
+    // ===================================================================== //
+    // constructor from the array, which must outlive the stream, and the
+    // selection of its points. The file is created by the owning ranks.
+    InSituStream(const DArray<T, NDIMS>& array, const Selection<NDIMS>& selection,
+                 const std::string& filename, OutputMode mode = OutputMode::COLLECTIVE)
+        : _array    (array)
+        , _stride   (selection.stride)
+        , _header   ()
+        , _mode     (mode)
+        , _comm     (MPI_COMM_NULL)
+        , _file     (MPI_FILE_NULL)
+        , _nrecords (0)
+        , _next     (0) {
+            const auto array_size = array.array_size();
+            for (auto dim : LinRange(NDIMS)) {
+                if (selection.stride[dim] <= 0 or selection.size[dim] <= 0)
+                    throw std::invalid_argument("selection size and stride must be positive");
+                if (selection.origin[dim] < 0 or
+                    selection.origin[dim] + selection.size[dim] > array_size[dim])
+                    throw std::out_of_range("selection out of the global array");
+            }
+
+            // selected points in the block of this rank, by their position
+            // s in the selection, at global index origin + s*stride
+            const auto shape  = selection.shape();
+            const auto origin = array.origin();
+            bool owner = true;
+            for (auto dim : LinRange(NDIMS)) {
+                const int stride = selection.stride[dim];
+                const int from   = origin[dim] - selection.origin[dim];
+                const int to     = from + array.size(dim);
+                const int s0 = from <= 0 ? 0 : (from + stride - 1)/stride;
+                const int s1 = to   <= 0 ? 0 : std::min(shape[dim], (to + stride - 1)/stride);
+                _offset[dim] = s0;
+                _count[dim]  = std::max(0, s1 - s0);
+                _first[dim]  = selection.origin[dim] + s0*stride - origin[dim];
+                owner        = owner and _count[dim] > 0;
+            }
+
+            std::strncpy(_header.magic, "DARRAYS", sizeof(_header.magic));
+            std::strncpy(_header.dtype, dtype_name<T>(), sizeof(_header.dtype));
+            _header.version = FileHeader::file_version;
+            _header.ndims   = NDIMS;
+            for (auto dim : LinRange(NDIMS)) {
+                _header.shape[dim] = shape[dim];
+                _header.grid[dim]  = array.layout().size(dim);
+            }
+
+            MPI_Comm_split(array.layout().communicator(), owner ? 0 : MPI_UNDEFINED,
+                           array.layout().rank(), &_comm);
+            if (!owner)
+                return;
+
+            for (auto& slot : _slots)
+                slot.resize(_npoints());
+
+            if (_mode == OutputMode::GATHER) {
+                int rank, nprocs;
+                MPI_Comm_rank(_comm, &rank);
+                MPI_Comm_size(_comm, &nprocs);
+                std::vector<int> box(_offset.begin(), _offset.end());
+                box.insert(box.end(), _count.begin(), _count.end());
+                if (rank == 0) {
+                    _boxes.resize(2*NDIMS*nprocs);
+                    _gathered.resize(std::accumulate(shape.begin(), shape.end(),
+                                                     size_t(1), std::multiplies<size_t>()));
+                }
+                MPI_Gather(box.data(), 2*NDIMS, MPI_INT,
+                           _boxes.data(), 2*NDIMS, MPI_INT, 0, _comm);
+            }
+
+            _file = _create_file(filename, _comm);
+    }
+
+    // ===================================================================== //
+    // snapshots in progress complete before the file is closed
+    ~InSituStream() {
+        _io.join();
+        if (_comm != MPI_COMM_NULL) {
+            MPI_File_close(&_file);
+            MPI_Comm_free(&_comm);
+        }
+    }
+
+    InSituStream(const InSituStream&) = delete;
+    InSituStream& operator = (const InSituStream&) = delete;
+
+    // ===================================================================== //
+    // whether this rank owns selected points, and writes them
+    inline bool is_active() const {
+        return _comm != MPI_COMM_NULL;
+    }
+
+    // number of points selected along each dimension
+    inline std::array<int, NDIMS> shape() const {
+        return _header.array_size<NDIMS>();
+    }
+
+    // ===================================================================== //
+    // copy the selected points of the array and append them to the file in
+    // the background. All ranks must call this, but it returns at once on
+    // ranks without selected points. This blocks if both staging buffers
+    // hold snapshots that are still being written.
+    CheckpointFuture push() {
+        if (!is_active()) {
+            std::promise<void> none;
+            none.set_value();
+            return CheckpointFuture(none.get_future().share());
+        }
+
+        const int slot = _next;
+        _next = 1 - _next;
+        if (_done[slot].valid())
+            _done[slot].wait();
+
+        // rows of points along the first dimension, from their first point
+        T* dest = _slots[slot].data();
+        auto rows = _count;
+        rows[0] = 1;
+        for (auto index : IndexRange<NDIMS>(rows)) {
+            for (auto dim : LinRange(NDIMS))
+                index[dim] = _first[dim] + index[dim]*_stride[dim];
+            const T* src = _array.cursor(index).ptr();
+            for (int i = 0; i != _count[0]; i++)
+                *dest++ = src[i*_stride[0]];
+        }
+
+        _done[slot] = _io.submit([this, data = _slots[slot].data(), n = _nrecords++] () {
+            _write(data, n);
+        });
+        return CheckpointFuture(_done[slot]);
+    }
+
+    // ===================================================================== //
+    // block until all snapshots are written
+    void wait() {
+        for (const auto& done : _done)
+            if (done.valid())
+                done.wait();
+    }
+};
+
+}
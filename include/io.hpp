@@ -0,0 +1,243 @@
+#pragma once
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Parallel I/O of DArrays to a single file. A file holds     //
+// records of a fixed-size header describing an array, and    //
+// the in-domain points of the global array in Fortran order. //
+// Each rank sees the file through a subarray view of its own //
+// block, and all ranks read or write at once with collective //
+// MPI-IO calls, so that halos never reach the file.          //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// name of the element type stored in the header, as in numpy
+template <typename T> inline const char* dtype_name();
+template <> inline const char* dtype_name<char>()                 { return "i1";  }
+template <> inline const char* dtype_name<int>()                  { return "i4";  }
+template <> inline const char* dtype_name<long>()                 { return "i8";  }
+template <> inline const char* dtype_name<unsigned>()             { return "u4";  }
+template <> inline const char* dtype_name<unsigned long>()        { return "u8";  }
+template <> inline const char* dtype_name<float>()                { return "f4";  }
+template <> inline const char* dtype_name<double>()               { return "f8";  }
+template <> inline const char* dtype_name<std::complex<float>>()  { return "c8";  }
+template <> inline const char* dtype_name<std::complex<double>>() { return "c16"; }
+
+// ===================================================================== //
+// file header, in the native byte order. Data starts at data_offset, so
+// that it is aligned to the blocks of the file system.
+struct FileHeader {
+    static constexpr int         max_dims = 8;
+    static constexpr long     data_offset = 4096;
+    static constexpr int32_t file_version = 1;
+
+    char                   magic[8]; // "DARRAYS"
+    int32_t                 version;
+    int32_t                   ndims;
+    char                   dtype[8]; // see dtype_name
+    int64_t         shape[max_dims]; // global array size
+    int32_t          grid[max_dims]; // processor grid of the writer
+    int32_t      periodic[max_dims]; // whether the layout of the writer wraps around
+
+    // ===================================================================== //
+    // header of an array
+    template <typename T, size_t NDIMS>
+    static FileHeader of(const DArray<T, NDIMS>& a) {
+        static_assert(NDIMS <= max_dims, "too many dimensions");
+        FileHeader header = {};
+        std::strncpy(header.magic, "DARRAYS", sizeof(header.magic));
+        std::strncpy(header.dtype, dtype_name<T>(), sizeof(header.dtype));
+        header.version   = file_version;
+        header.ndims     = NDIMS;
+        for (auto dim : LinRange(NDIMS)) {
+            header.shape[dim]    = a.array_size()[dim];
+            header.grid[dim]     = a.layout().size(dim);
+            header.periodic[dim] = a.layout().is_periodic(dim);
+        }
+        return header;
+    }
+
+    // ===================================================================== //
+    // whether data for the given array can be read from this file, whose
+    // kind is given by the magic string, e.g. "DARRAYZ" for compressed files
+    template <typename T, size_t NDIMS>
+    void check(const DArray<T, NDIMS>& a, const char* kind = "DARRAYS") const {
+        if (std::strncmp(magic, kind, sizeof(magic)) != 0 or version != file_version)
+            throw std::invalid_argument("not a DArray file");
+        if (std::strncmp(dtype, dtype_name<T>(), sizeof(dtype)) != 0)
+            throw std::invalid_argument("element type does not match file");
+        if (ndims != static_cast<int32_t>(NDIMS))
+            throw std::invalid_argument("number of dimensions does not match file");
+        for (auto dim : LinRange(NDIMS))
+            if (shape[dim] != a.array_size()[dim])
+                throw std::invalid_argument("array size does not match file");
+    }
+
+    // ===================================================================== //
+    // global array size, e.g. to create arrays to read the file into
+    template <size_t NDIMS>
+    std::array<int, NDIMS> array_size() const {
+        if (ndims != static_cast<int32_t>(NDIMS))
+            throw std::invalid_argument("number of dimensions does not match file");
+        std::array<int, NDIMS> size;
+        for (auto dim : LinRange(NDIMS))
+            size[dim] = shape[dim];
+        return size;
+    }
+
+    // ===================================================================== //
+    // number of bytes of an element, e.g. 8 for "f8"
+    inline long element_size() const {
+        return std::atol(dtype + 1);
+    }
+
+    // ===================================================================== //
+    // size in the file of the header and data of the array: records are
+    // padded to a multiple of data_offset, so that all of them are aligned
+    inline long record_size() const {
+        long n = element_size();
+        for (auto dim : LinRange(ndims))
+            n *= shape[dim];
+        return data_offset*(1 + (n + data_offset - 1)/data_offset);
+    }
+};
+
+// ===================================================================== //
+// headers of the records of a file, read by the first rank of comm and
+// broadcast, with the offset of each record from the start of the file
+inline std::vector<std::pair<FileHeader, long>> read_headers(const std::string& filename,
+                                                             MPI_Comm comm) {
+    MPI_File file;
+    if (MPI_File_open(comm, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+        throw std::runtime_error("cannot open file " + filename);
+
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    std::vector<std::pair<FileHeader, long>> headers;
+    if (rank == 0) {
+        MPI_Offset size;
+        MPI_File_get_size(file, &size);
+        // the first header is returned whatever its kind, e.g. that of a
+        // compressed file, and the following ones only if they are records
+        for (long offset = 0; offset < size; ) {
+            FileHeader header = {};
+            MPI_Status status;
+            int count;
+            MPI_File_read_at(file, offset, &header, sizeof(header), MPI_BYTE, &status);
+            MPI_Get_count(&status, MPI_BYTE, &count);
+            const bool record = count == sizeof(header)
+                and std::strncmp(header.magic, "DARRAYS", sizeof(header.magic)) == 0;
+            if (!headers.empty() and !record)
+                break;
+            headers.emplace_back(header, offset);
+            if (!record)
+                break;
+            offset += header.record_size();
+        }
+    }
+    long n = headers.size();
+    MPI_Bcast(&n, 1, MPI_LONG, 0, comm);
+    headers.resize(n);
+    MPI_Bcast(headers.data(), n*sizeof(headers[0]), MPI_BYTE, 0, comm);
+    MPI_File_close(&file);
+    return headers;
+}
+
+// header of the first record of a file
+inline FileHeader read_header(const std::string& filename, MPI_Comm comm) {
+    const auto headers = read_headers(filename, comm);
+    if (headers.empty())
+        throw std::invalid_argument("not a DArray file");
+    return headers.front().first;
+}
+
+// ===================================================================== //
+// file view of the block of in-domain points owned by a rank, in the data
+// of a record starting at the given offset
+template <typename T, size_t NDIMS>
+inline void _set_view(MPI_File file, long offset, const DArray<T, NDIMS>& a,
+                      MPI_Datatype* filetype) {
+    const auto origin = a.origin();
+    MPI_Type_create_subarray(NDIMS,
+                             a.array_size().data(),
+                             a.size().data(),
+                             origin.data(),
+                             MPI_ORDER_FORTRAN,
+                             MPI::mpi_type<T>(), filetype);
+    MPI_Type_commit(filetype);
+    MPI_File_set_view(file, offset + FileHeader::data_offset, MPI::mpi_type<T>(), *filetype,
+                      "native", MPI_INFO_NULL);
+}
+
+// ===================================================================== //
+// collective write of the record of an array at the given offset, from
+// count elements of type memtype at buffer, e.g. from the array itself or
+// from a copy of its in-domain points. Returns the end of the record.
+template <typename T, size_t NDIMS>
+long _write_record(MPI_File file, long offset, const DArray<T, NDIMS>& a,
+                   const void* buffer, int count, MPI_Datatype memtype) {
+    // offsets are relative to the view, which may be that of another record
+    MPI_File_set_view(file, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+    const FileHeader header = FileHeader::of(a);
+    if (a.layout().rank() == 0)
+        MPI_File_write_at(file, offset, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+
+    MPI_Datatype filetype;
+    _set_view(file, offset, a, &filetype);
+    MPI_File_write_all(file, buffer, count, memtype, MPI_STATUS_IGNORE);
+    MPI_Type_free(&filetype);
+    return offset + header.record_size();
+}
+
+// collective read of the data of the record at the given offset
+template <typename T, size_t NDIMS>
+void _read_record(MPI_File file, long offset, DArray<T, NDIMS>& a) {
+    MPI_Datatype filetype;
+    _set_view(file, offset, a, &filetype);
+    SubArray<T, NDIMS> interior(a, std::array<int, NDIMS>{}, a.size());
+    MPI_File_read_all(file, a.data(), 1, interior.type(), MPI_STATUS_IGNORE);
+    MPI_Type_free(&filetype);
+}
+
+// ===================================================================== //
+// open a file for writing on all ranks of comm, discarding its content
+inline MPI_File _create_file(const std::string& filename, MPI_Comm comm) {
+    MPI_File file;
+    if (MPI_File_open(comm, filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &file) != MPI_SUCCESS)
+        throw std::runtime_error("cannot open file " + filename);
+    MPI_File_set_size(file, 0);
+    return file;
+}
+
+// ===================================================================== //
+// collective write and read of the in-domain points, see DArray::write
+template <typename T, size_t NDIMS>
+void _write_file(const DArray<T, NDIMS>& a, const std::string& filename) {
+    MPI_File file = _create_file(filename, a.layout().communicator());
+    SubArray<T, NDIMS> interior(a, std::array<int, NDIMS>{}, a.size());
+    _write_record(file, 0, a, a.data(), 1, interior.type());
+    MPI_File_close(&file);
+}
+
+template <typename T, size_t NDIMS>
+void _read_file(DArray<T, NDIMS>& a, const std::string& filename) {
+    // all ranks see the same header, and throw together
+    read_header(filename, a.layout().communicator()).check(a);
+
+    MPI_File file;
+    if (MPI_File_open(a.layout().communicator(), filename.c_str(), MPI_MODE_RDONLY,
+                      MPI_INFO_NULL, &file) != MPI_SUCCESS)
+        throw std::runtime_error("cannot open file " + filename);
+    _read_record(file, 0, a);
+    MPI_File_close(&file);
+}
+
+}
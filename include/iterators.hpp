@@ -2,6 +2,7 @@
 #include <iostream>
 #include <iterator>
 #include <numeric>
+#include <algorithm>
 #include <array>
 #include <cmath>
 
@@ -55,69 +56,87 @@ public:
 template <size_t NDIMS>
 class IndexRange {
 private:
+    std::array<int, NDIMS> _origin;    // first index
     std::array<int, NDIMS> _size;      // array size
+    long                   _first;     // linear position of the first index
+    long                   _last;      // linear position of one past the last index
 
     class _IndexRangeIter {
     public:
         // ===================================================================== //        
         // ITERATOR TRAITS
-        using difference_type = int;
+        // indices are returned by value, so that copies of an iterator 
+        // can be used concurrently, e.g. by the parallel algorithms
+        using difference_type = long;
         using value_type = std::array<int, NDIMS>;
-        using reference = std::array<int, NDIMS>&;
+        using reference = std::array<int, NDIMS>;
+        using pointer = const std::array<int, NDIMS>*;
         using iterator_category = std::random_access_iterator_tag;
-        // using pointer = const long*;
 
     private:
         std::array<int, NDIMS> _state;     // current indices  // e.g. {1, 2, 3}
+        std::array<int, NDIMS> _origin;    // first indices    // e.g. {0, 0, 0}
         std::array<int, NDIMS> _size;      // array sizes      // e.g. {2, 3, 4}
         std::array<int, NDIMS> _size_prod; // product of sizes // e.g. {1, 2, 6}
+        difference_type        _n;         // linear position of the current indices
 
         // ===================================================================== //
-        // EXPAND STATE TO/FROM LINEARISED INDEX
-        inline difference_type _tolinearindex() const {
-            difference_type n = 0;
-            for ( auto dim : LinRange(NDIMS) )
-                n += _size_prod[dim] * _state[dim];
-            return n;
-        }
-
+        // EXPAND STATE FROM LINEARISED INDEX
         inline void _fromlinearindex(difference_type n) {
-            div_t divrem;            
+            _n = n;
             for ( auto dim : LinRange(NDIMS-1, -1, -1) ) {
-                divrem = div(n, _size_prod[dim]);
-                _state[dim] = divrem.quot;
-                n = divrem.rem;
+                _state[dim] = n / _size_prod[dim] + _origin[dim];
+                n = n % _size_prod[dim];
             }
         }
 
     public:
         // ===================================================================== //
         // CONSTRUCTOR/DESTRUCTOR
-        _IndexRangeIter(std::array<int, NDIMS> size, std::array<int, NDIMS> state)
-            : _size       (size )  
-            , _state      (state) {
+        _IndexRangeIter() = default;
+
+        _IndexRangeIter(std::array<int, NDIMS> origin,
+                        std::array<int, NDIMS> size,
+                        difference_type        n)
+            : _origin     (origin)
+            , _size       (size  ) {
                 // compute product of array sizes
                 _size_prod[0] = 1;
                 for (auto dim : LinRange(1, NDIMS)) {
                     _size_prod[dim] = _size_prod[dim-1]*_size[dim-1];
                 }
+                _fromlinearindex(n);
             }
 
         // ===================================================================== //
         // DEREFERENCING
-        inline reference operator * () {
+        inline reference operator * () const {
             return _state;
         }
 
+        inline pointer operator -> () const {
+            return &_state;
+        }
+
+        inline reference operator [] (difference_type n) const {
+            return *(*this + n);
+        }
+
         // ===================================================================== //
-        // INCREMENT
-        inline _IndexRangeIter operator ++ () {
-            _state[0]++;
-            // TODO: benchmark this compare to simpler loop. Is the
-            // compiler able to unroll this efficiently?
+        // INCREMENT/DECREMENT
+        inline _IndexRangeIter& operator ++ () {
+            _n++;
+            // fast path, no carry
+            if (++_state[0] != _origin[0] + _size[0])
+                return *this;
+            // carry over to the next dimensions. The carry itself is cheap,
+            // see benchmarks/bench_indexing.cpp: a copy runs about as fast
+            // as nested loops. Loops over these iterators do not vectorise
+            // though, so stencils run 2-3 times slower: use rows or cursors
+            // in hot loops.
             for ( auto dim : LinRange(NDIMS-1) ) {
-                if (_state[dim] == _size[dim]) {
-                    _state[dim] = 0; 
+                if (_state[dim] == _origin[dim] + _size[dim]) {
+                    _state[dim] = _origin[dim];
                     _state[dim+1]++;
                 } else {
                     break;
@@ -126,35 +145,71 @@ private:
             return *this;
         }
 
+        inline _IndexRangeIter& operator -- () {
+            _n--;
+            for ( auto dim : LinRange(NDIMS) ) {
+                if (_state[dim] == _origin[dim]) {
+                    _state[dim] = _origin[dim] + _size[dim] - 1;
+                } else {
+                    _state[dim]--;
+                    break;
+                }
+            }
+            return *this;
+        }
+
+        inline _IndexRangeIter operator ++ (int) {
+            _IndexRangeIter tmp = *this; ++*this; return tmp;
+        }
+
+        inline _IndexRangeIter operator -- (int) {
+            _IndexRangeIter tmp = *this; --*this; return tmp;
+        }
+
         // ===================================================================== //
         // ADD/REMOVE LINEAR INDEX
         inline _IndexRangeIter& operator += (difference_type n) {
-            _fromlinearindex(_tolinearindex() + n);
+            _fromlinearindex(_n + n);
             return *this;
         }
 
         inline _IndexRangeIter& operator -= (difference_type n) {
-            _fromlinearindex(_tolinearindex() - n);
+            _fromlinearindex(_n - n);
             return *this;
         }
 
+        inline _IndexRangeIter operator + (difference_type n) const {
+            _IndexRangeIter tmp = *this; return tmp += n;
+        }
+
+        inline _IndexRangeIter operator - (difference_type n) const {
+            _IndexRangeIter tmp = *this; return tmp -= n;
+        }
+
+        inline friend _IndexRangeIter operator + (difference_type n, const _IndexRangeIter& it) {
+            return it + n;
+        }
+
+        // ===================================================================== //
+        // DISTANCE
+        inline difference_type operator - (const _IndexRangeIter& other) const {
+            return _n - other._n;
+        }
+
         // ===================================================================== //
         // EQUALITY AND COMPARISON
         inline bool operator == (const _IndexRangeIter& other) const {
-            return _state == other._state;
+            return _n == other._n;
         }
 
         inline bool operator != (const _IndexRangeIter& other) const {
-            return !(*this == other);
+            return _n != other._n;
         }
 
-        inline bool operator < (const _IndexRangeIter& other) const {
-            return _tolinearindex() < other._tolinearindex();
-        }
-
-        inline bool operator > (const _IndexRangeIter& other) const {
-            return _tolinearindex() > other._tolinearindex();
-        }
+        inline bool operator <  (const _IndexRangeIter& other) const { return _n <  other._n; }
+        inline bool operator >  (const _IndexRangeIter& other) const { return _n >  other._n; }
+        inline bool operator <= (const _IndexRangeIter& other) const { return _n <= other._n; }
+        inline bool operator >= (const _IndexRangeIter& other) const { return _n >= other._n; }
     };
 
 public:
@@ -165,25 +220,272 @@ public:
               typename ENABLER = std::enable_if_t< (... && std::is_integral_v<NS>) >>
     IndexRange(NS... ns) {
         static_assert(sizeof...(ns) == NDIMS, "too many indiced for iterator dimension");
+        _origin.fill(0);
         _size = {ns...};
+        _first = 0;
+        _last  = std::accumulate(_size.begin(), _size.end(), 1L, std::multiplies<>());
     }
 
     // from an array of integer sizes
     template<typename T, 
             typename ENABLER = std::enable_if_t< std::is_integral_v<T> >>
     IndexRange(std::array<T, NDIMS> size) 
-        : _size (size) {}
+        : _size  (size)
+        , _first (0)
+        , _last  (std::accumulate(size.begin(), size.end(), 1L, std::multiplies<>())) {
+            _origin.fill(0);
+    }
+
+    // from arrays of integer origin and sizes, for ranges not starting at zero
+    template<typename T, 
+            typename ENABLER = std::enable_if_t< std::is_integral_v<T> >>
+    IndexRange(std::array<T, NDIMS> origin, std::array<T, NDIMS> size) 
+        : _origin (origin)
+        , _size   (size  )
+        , _first  (0)
+        , _last   (std::accumulate(size.begin(), size.end(), 1L, std::multiplies<>())) {}
 
-    _IndexRangeIter begin() { 
-        std::array<int, NDIMS> _state = {0};
-        return {_size, _state}; 
+    // first index and number of indices along each dimension of the 
+    // box the range is defined on
+    inline const std::array<int, NDIMS>& origin() const { return _origin; }
+    inline const std::array<int, NDIMS>&   size() const { return _size;   }
+
+    // number of indices in the range
+    inline long length() const { return _last - _first; }
+
+    // ===================================================================== //
+    // the part-th of nparts consecutive sub-ranges of equal length, to
+    // within one index. Sub-ranges are not boxes in general.
+    inline IndexRange split(int part, int nparts) const {
+        IndexRange sub = *this;
+        sub._first = _first + length()*part/nparts;
+        sub._last  = _first + length()*(part + 1)/nparts;
+        return sub;
+    }
+
+    _IndexRangeIter begin() const { 
+        return {_origin, _size, _first}; 
     }
     
-    _IndexRangeIter end() {
-        // constuct state for one past the last
-        std::array<int, NDIMS> _state = {0}; _state[NDIMS - 1] = _size[NDIMS - 1];
-        return {_size, _state};
+    _IndexRangeIter end() const {
+        return {_origin, _size, _last};
+    }
+};
+
+
+////////////////////////////////////////////////////////
+//               coloured index range                 //
+////////////////////////////////////////////////////////
+// ===================================================================== //
+// indices of a box whose sum has the given parity, i.e. one colour of a
+// red-black ordering. Points are visited row by row, every other point
+// along dimension 0; offset() gives the start of each row, for loops
+// over contiguous rows with stride 2 that vectorise.
+template <size_t NDIMS>
+class ColouredIndexRange {
+private:
+    IndexRange<NDIMS>     _rows; // first index of each row of the box
+    int                   _end0; // one past the last index along dimension 0
+    int                 _parity; // parity of the sum of the indices
+
+    static std::array<int, NDIMS> _nrows(std::array<int, NDIMS> size) {
+        size[0] = 1;
+        return size;
     }
+
+    // ===================================================================== //
+    // iterator over rows, then every other point within a row. Rows are
+    // stepped through with the carry increment of IndexRange.
+    class _ColouredIndexRangeIter {
+    private:
+        using _RowIter = decltype(std::declval<IndexRange<NDIMS>>().begin());
+
+        const ColouredIndexRange*  _range;
+        _RowIter                     _row; // first index of the current row
+        std::array<int, NDIMS>     _index; // current index
+
+        // move to the first point of the colour from the start of the
+        // current row, skipping rows with no such point
+        inline void _settle() {
+            const auto end = _range->_rows.end();
+            while (_row != end) {
+                _index     = *_row;
+                _index[0] += _range->offset(_index);
+                if (_index[0] < _range->_end0)
+                    return;
+                ++_row;
+            }
+            _index.fill(0);
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = std::array<int, NDIMS>;
+        using difference_type   = long;
+        using pointer           = const value_type*;
+        using reference         = const value_type&;
+
+        _ColouredIndexRangeIter(const ColouredIndexRange* range, _RowIter row)
+            : _range (range)
+            , _row   (row  ) {
+                _settle();
+        }
+
+        inline const std::array<int, NDIMS>& operator * () const {
+            return _index;
+        }
+
+        inline _ColouredIndexRangeIter& operator ++ () {
+            _index[0] += 2;
+            if (_index[0] >= _range->_end0) {
+                ++_row;
+                _settle();
+            }
+            return *this;
+        }
+
+        inline bool operator != (const _ColouredIndexRangeIter& other) const {
+            return _row != other._row or _index[0] != other._index[0];
+        }
+
+        inline bool operator == (const _ColouredIndexRangeIter& other) const {
+            return !(*this != other);
+        }
+    };
+
+public:
+    ColouredIndexRange(std::array<int, NDIMS> origin,
+                       std::array<int, NDIMS> size,
+                       int                    parity)
+        : _rows   (origin, _nrows(size))
+        , _end0   (origin[0] + size[0])
+        , _parity (((parity % 2) + 2) % 2) {}
+
+    // ===================================================================== //
+    // 0 or 1, the number of points to skip from index along dimension 0
+    // to reach the first point of the colour
+    inline int offset(const std::array<int, NDIMS>& index) const {
+        int sum = _parity;
+        for (auto dim : LinRange(NDIMS))
+            sum += index[dim];
+        return sum & 1;
+    }
+
+    _ColouredIndexRangeIter begin() const { return {this, _rows.begin()}; }
+    _ColouredIndexRangeIter   end() const { return {this, _rows.end()};   }
+};
+
+
+////////////////////////////////////////////////////////
+//                  tile range                        //
+////////////////////////////////////////////////////////
+// ===================================================================== //
+// rectangular block of indices, with origin and size
+template <size_t NDIMS>
+class Tile {
+private:
+    std::array<int, NDIMS> _origin; // first index in the tile
+    std::array<int, NDIMS>   _size; // number of indices along each dimension
+
+public:
+    Tile(std::array<int, NDIMS> origin, std::array<int, NDIMS> size)
+        : _origin (origin)
+        , _size   (size  ) {}
+
+    inline const std::array<int, NDIMS>& origin() const { return _origin; }
+    inline const std::array<int, NDIMS>&   size() const { return _size;   }
+
+    inline int origin(size_t dim) const { return _origin[dim]; }
+    inline int   size(size_t dim) const { return _size[dim];   }
+
+    // iterator over the indices in the tile
+    inline IndexRange<NDIMS> indices() const {
+        return IndexRange<NDIMS>(_origin, _size);
+    }
+};
+
+// ===================================================================== //
+// partition of the index range [0, size) into tiles of given shape. Tiles
+// on the high end of each dimension are cut to fit in the range.
+template <size_t NDIMS>
+class TileRange {
+private:
+    std::array<int, NDIMS>   _size; // size of the whole range
+    std::array<int, NDIMS>  _shape; // tile shape
+    std::array<int, NDIMS> _ntiles; // number of tiles along each dimension
+
+    // ===================================================================== //
+    // iterator over the tiles, first dimension fastest. The origin of the
+    // current tile is moved on with the carry increment of IndexRange, so
+    // that the position in the grid of tiles is never divided out.
+    class _TileRangeIter {
+    private:
+        const TileRange*          _range;
+        long                          _n; // linear position of the tile
+        std::array<int, NDIMS>   _origin; // origin of the current tile
+
+    public:
+        _TileRangeIter(const TileRange* range, long n)
+            : _range (range)
+            , _n     (n    ) {
+                for (auto dim : LinRange(NDIMS)) {
+                    const int ntiles = std::max(_range->_ntiles[dim], 1);
+                    _origin[dim] = (n % ntiles)*_range->_shape[dim];
+                    n /= ntiles;
+                }
+        }
+
+        inline Tile<NDIMS> operator * () const {
+            std::array<int, NDIMS> size;
+            for (auto dim : LinRange(NDIMS))
+                size[dim] = std::min(_range->_shape[dim], _range->_size[dim] - _origin[dim]);
+            return {_origin, size};
+        }
+
+        inline _TileRangeIter& operator ++ () {
+            _n++;
+            for (auto dim : LinRange(NDIMS)) {
+                _origin[dim] += _range->_shape[dim];
+                if (_origin[dim] < _range->_size[dim])
+                    break;
+                _origin[dim] = 0;
+            }
+            return *this;
+        }
+
+        inline bool operator != (const _TileRangeIter& other) const {
+            return _n != other._n;
+        }
+    };
+
+public:
+    TileRange(std::array<int, NDIMS> size, std::array<int, NDIMS> shape)
+        : _size  (size )
+        , _shape (shape) {
+            for (auto dim : LinRange(NDIMS)) {
+                if (_shape[dim] <= 0)
+                    throw std::invalid_argument("tile shape must be positive");
+                _ntiles[dim] = (_size[dim] + _shape[dim] - 1)/_shape[dim];
+            }
+    }
+
+    // number of tiles along each dimension
+    inline const std::array<int, NDIMS>& ntiles() const {
+        return _ntiles;
+    }
+
+    // tile at given position in the grid of tiles
+    inline Tile<NDIMS> tile(const std::array<int, NDIMS>& position) const {
+        std::array<int, NDIMS> origin, size;
+        for (auto dim : LinRange(NDIMS)) {
+            origin[dim] = position[dim]*_shape[dim];
+            size[dim]   = std::min(_shape[dim], _size[dim] - origin[dim]);
+        }
+        return {origin, size};
+    }
+
+    _TileRangeIter begin() const { return {this, 0};                                  }
+    _TileRangeIter   end() const { return {this, IndexRange<NDIMS>(_ntiles).length()}; }
 };
 
 } // namespace Darrays::Iterators
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+#include <type_traits>
+#include <stdexcept>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// File-backed storage for out-of-core arrays. The memory     //
+// buffer of a rank, halos included, is mapped from a local   //
+// file, so that it lives in the page cache rather than in    //
+// anonymous memory, and indexing, expressions and halo swaps //
+// work unchanged. Mapping the file again, e.g. on restart,   //
+// gives back the data without reading it.                    //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// hints on how the buffer of an array will be accessed, see madvise
+enum class Advice : int {
+    NORMAL     = MADV_NORMAL,
+    SEQUENTIAL = MADV_SEQUENTIAL, // sweeps through the whole array
+    RANDOM     = MADV_RANDOM,     // scattered accesses, no read-ahead
+    WILLNEED   = MADV_WILLNEED    // start reading the file in
+};
+
+// ===================================================================== //
+// pages spanning the buffer of an array
+template <typename T, size_t NDIMS>
+inline std::pair<void*, size_t> _pages(const DArray<T, NDIMS>& a) {
+    const auto page  = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto begin = reinterpret_cast<uintptr_t>(a.data()) & ~(page - 1);
+    const auto end   = reinterpret_cast<uintptr_t>(a.data() + a.nelements());
+    return {reinterpret_cast<void*>(begin), end - begin};
+}
+
+// ===================================================================== //
+// allocator mapping the buffer from the file at path, shared with the
+// file: a new or empty file is extended to the size of the buffer and
+// reads as zeros, while an existing one must have exactly that size. Each
+// rank must use a file of its own, e.g. with the rank in its name.
+template <typename T>
+Allocator<T> mapped_file(const std::string& path, Advice advice = Advice::SEQUENTIAL) {
+    static_assert(std::is_trivially_copyable_v<T>, "mapped arrays need trivially copyable elements");
+    return [path, advice](size_t n) {
+        const size_t nbytes = n*sizeof(T);
+
+        const int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            throw std::runtime_error("cannot open file " + path);
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("cannot read size of file " + path);
+        }
+        if (info.st_size != 0 and static_cast<size_t>(info.st_size) != nbytes) {
+            close(fd);
+            throw std::invalid_argument("size of file " + path + " does not match array");
+        }
+        if (info.st_size == 0 and ftruncate(fd, nbytes) != 0) {
+            close(fd);
+            throw std::runtime_error("cannot resize file " + path);
+        }
+
+        // the mapping keeps the file open
+        void* ptr = mmap(nullptr, nbytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED)
+            throw std::runtime_error("cannot map file " + path);
+        madvise(ptr, nbytes, static_cast<int>(advice));
+
+        return std::shared_ptr<T>(static_cast<T*>(ptr),
+                                  [nbytes](T* p) { munmap(p, nbytes); });
+    };
+}
+
+// ===================================================================== //
+// change the access hint of the buffer of an array, e.g. RANDOM before
+// probing points and SEQUENTIAL again before a sweep
+template <typename T, size_t NDIMS>
+void advise(const DArray<T, NDIMS>& a, Advice advice) {
+    const auto [ptr, nbytes] = _pages(a);
+    madvise(ptr, nbytes, static_cast<int>(advice));
+}
+
+// ===================================================================== //
+// write the modified pages of a mapped array back to its file, e.g. to
+// make a consistent restart point. The data reaches the file anyway when
+// the array goes away, but not at a controlled time.
+template <typename T, size_t NDIMS>
+void sync(const DArray<T, NDIMS>& a) {
+    const auto [ptr, nbytes] = _pages(a);
+    if (msync(ptr, nbytes, MS_SYNC) != 0)
+        throw std::runtime_error("cannot write array to file");
+}
+
+}
@@ -1,12 +1,45 @@
 #pragma once
-// #include "subarray.hpp"
+#include <complex>
+#include <stdexcept>
+#include <string>
+#include "trace.hpp"
+
+namespace DArrays {
+
+// forward declaration
+template <typename T, size_t NDIMS> class SubArray;
+
+}
 
 namespace DArrays::MPI {
 
 // ===================================================================== //
-// initialize/finalize mpi session            
-inline void Initialize() {
-    MPI_Init(nullptr, nullptr);
+// mpi data type matching the element type T
+template <typename T> inline MPI_Datatype mpi_type();
+
+template <> inline MPI_Datatype mpi_type<char>                () { return MPI_CHAR;                }
+template <> inline MPI_Datatype mpi_type<int>                 () { return MPI_INT;                 }
+template <> inline MPI_Datatype mpi_type<long>                () { return MPI_LONG;                }
+template <> inline MPI_Datatype mpi_type<unsigned>            () { return MPI_UNSIGNED;            }
+template <> inline MPI_Datatype mpi_type<unsigned long>       () { return MPI_UNSIGNED_LONG;       }
+template <> inline MPI_Datatype mpi_type<float>               () { return MPI_FLOAT;               }
+template <> inline MPI_Datatype mpi_type<double>              () { return MPI_DOUBLE;              }
+template <> inline MPI_Datatype mpi_type<std::complex<float>> () { return MPI_CXX_FLOAT_COMPLEX;   }
+template <> inline MPI_Datatype mpi_type<std::complex<double>>() { return MPI_CXX_DOUBLE_COMPLEX;  }
+
+// ===================================================================== //
+// initialize/finalize mpi session. Threads other than the main one do
+// not make MPI calls, see ThreadPool, so FUNNELED support is enough, but
+// for checkpoints written in the background, see AsyncCheckpoint, ask
+// for MULTIPLE. Throws if the library provides less than required, rather
+// than letting AsyncCheckpoint quietly write in the foreground.
+inline void Initialize(int required = MPI_THREAD_FUNNELED) {
+    int provided;
+    MPI_Init_thread(nullptr, nullptr, required, &provided);
+    if (provided < required)
+        throw std::runtime_error("MPI thread support level " + std::to_string(provided)
+                                 + " is lower than the required level "
+                                 + std::to_string(required));
 }
 
 inline void Finalize() {
@@ -18,6 +51,8 @@ inline void Finalize() {
 template <typename T, size_t NDIMS>
 void sendrecv(SubArray<T, NDIMS>& tosend, int dest_rank, 
               SubArray<T, NDIMS>& torecv, int src_rank) {
+    // with derived datatypes, packing and unpacking happen within MPI
+    TraceRegion region("sendrecv", "halo");
     MPI_Sendrecv(tosend.parent().data(),
                  1,
                  tosend.type(),
@@ -32,4 +67,43 @@ void sendrecv(SubArray<T, NDIMS>& tosend, int dest_rank,
                  MPI_STATUS_IGNORE);
 }
 
-}
\ No newline at end of file
+// ===================================================================== //
+// non-blocking send/recv of haloregion, on the communicator of the
+// parent array unless another one is given
+template <typename T, size_t NDIMS>
+MPI_Request isend(SubArray<T, NDIMS>& tosend, int dest_rank, int tag, MPI_Comm comm) {
+    MPI_Request request;
+    MPI_Isend(tosend.parent().data(),
+              1,
+              tosend.type(),
+              dest_rank,
+              tag,
+              comm,
+              &request);
+    return request;
+}
+
+template <typename T, size_t NDIMS>
+MPI_Request irecv(SubArray<T, NDIMS>& torecv, int src_rank, int tag, MPI_Comm comm) {
+    MPI_Request request;
+    MPI_Irecv(torecv.parent().data(),
+              1,
+              torecv.type(),
+              src_rank,
+              tag,
+              comm,
+              &request);
+    return request;
+}
+
+template <typename T, size_t NDIMS>
+MPI_Request isend(SubArray<T, NDIMS>& tosend, int dest_rank, int tag) {
+    return isend(tosend, dest_rank, tag, tosend.parent().layout().communicator());
+}
+
+template <typename T, size_t NDIMS>
+MPI_Request irecv(SubArray<T, NDIMS>& torecv, int src_rank, int tag) {
+    return irecv(torecv, src_rank, tag, torecv.parent().layout().communicator());
+}
+
+}
@@ -0,0 +1,350 @@
+#pragma once
+#include <stdexcept>
+#include <memory>
+#include <vector>
+#include <deque>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Hierarchy of grids for cell-centred multigrid. Each level  //
+// halves the number of cells along all dimensions. When the  //
+// cells per rank would drop below a minimum, the level is    //
+// agglomerated on a coarser processor grid, whose ranks form //
+// a sub-communicator split from the Cartesian communicator   //
+// of the finer level: the other ranks sit idle on that level //
+// and on all coarser ones.                                   //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// average of the 2^NDIMS fine cells of each coarse cell, row by row
+template <typename T, size_t NDIMS>
+inline void _restrict_average(DArray<T, NDIMS>& coarse, const DArray<T, NDIMS>& fine) {
+    const T scale = T(1) / (1 << NDIMS);
+    std::array<int, NDIMS> children;
+    children.fill(2);
+    children[0] = 1;
+
+    for (const auto& row : coarse.rows()) {
+        T* __restrict__ out = row.data();
+        for (int i = 0; i != row.size(); i++)
+            out[i] = 0;
+        for (const auto& child : IndexRange<NDIMS>(children)) {
+            std::array<int, NDIMS> index;
+            for (auto dim : LinRange(NDIMS))
+                index[dim] = 2*row.index()[dim] + child[dim];
+            const T* __restrict__ in = fine.row(index).data();
+            for (int i = 0; i != row.size(); i++)
+                out[i] += in[2*i] + in[2*i + 1];
+        }
+        for (int i = 0; i != row.size(); i++)
+            out[i] *= scale;
+    }
+}
+
+// ===================================================================== //
+// add the linear interpolation of the coarse cells to the fine cells. The
+// coarse rows are first combined along dimensions 1 and above, with
+// weights 3/4 and 1/4, then interpolated along dimension 0. This uses one
+// layer of halo points of the coarse array, corners included.
+template <typename T, size_t NDIMS>
+inline void _prolongate_add(DArray<T, NDIMS>& fine, const DArray<T, NDIMS>& coarse) {
+    const int nc = coarse.size(0);
+    std::vector<T> line(nc + 2);
+    std::array<int, NDIMS> sides;
+    sides.fill(2);
+    sides[0] = 1;
+
+    for (const auto& row : fine.rows()) {
+        std::fill(line.begin(), line.end(), T(0));
+        for (const auto& side : IndexRange<NDIMS>(sides)) {
+            std::array<int, NDIMS> index;
+            index[0] = -1;
+            T weight = 1;
+            for (auto dim : LinRange(1, NDIMS)) {
+                const int j = row.index()[dim];
+                index[dim] = j/2 + side[dim]*(j % 2 == 0 ? -1 : 1);
+                weight    *= side[dim] == 0 ? T(0.75) : T(0.25);
+            }
+            const T* __restrict__ in = coarse.cursor(index).ptr();
+            for (int i = 0; i != nc + 2; i++)
+                line[i] += weight*in[i];
+        }
+        T* __restrict__ out = row.data();
+        for (int i = 0; i != nc; i++) {
+            out[2*i]     += T(0.75)*line[i + 1] + T(0.25)*line[i];
+            out[2*i + 1] += T(0.75)*line[i + 1] + T(0.25)*line[i + 2];
+        }
+    }
+}
+
+// ===================================================================== //
+// MultigridHierarchy: layouts and sizes of all levels, with restriction
+// and prolongation between consecutive levels. Level 0 is the finest.
+template <typename T, size_t NDIMS>
+class MultigridHierarchy {
+private:
+    struct _Level {
+        std::unique_ptr<DArrayLayout<NDIMS>>  layout; // null if this rank is idle
+        std::array<int, NDIMS>            array_size; // global array size
+        std::array<int, NDIMS>                  grid; // processor grid size
+        std::array<int, NDIMS>                factor; // ratio of the processor grid of the previous level to this one
+        std::unique_ptr<DArray<T, NDIMS>>    staging; // restricted data on the previous
+                                                      // layout, for agglomerated levels
+        bool agglomerated() const {
+            for (auto f : factor)
+                if (f != 1)
+                    return true;
+            return false;
+        }
+    };
+
+    std::vector<_Level>   _levels;
+    std::array<int, NDIMS> _nhalo_out; // halo points of the arrays of all levels
+    std::array<int, NDIMS>  _nhalo_in;
+
+    // ===================================================================== //
+    // smallest factor larger than one of n, or one
+    static int _smallest_factor(int n) {
+        for (int f = 2; f <= n; f++)
+            if (n % f == 0)
+                return f;
+        return 1;
+    }
+
+    // ===================================================================== //
+    // rank, on the communicator of the given level, of the rank that holds
+    // the data of the current rank on the next, agglomerated, level
+    int _leader_rank(int level) const {
+        const auto& layout = *_levels[level].layout;
+        const auto& factor = _levels[level + 1].factor;
+        std::array<int, NDIMS> leader = layout.coords();
+        for (auto dim : LinRange(NDIMS))
+            leader[dim] -= leader[dim] % factor[dim];
+        int rank;
+        MPI_Cart_rank(layout.communicator(), leader.data(), &rank);
+        return rank;
+    }
+
+    // ===================================================================== //
+    // gather: send the staging area of the given level to the leader of the
+    // group, which places it in the coarse array. Otherwise, scatter: the
+    // leader sends each part of the coarse array back, with one layer of
+    // halo points for the interpolation.
+    void _exchange(int level, DArray<T, NDIMS>* coarse, bool gather) {
+        const auto& layout  = *_levels[level].layout;
+        const auto& next    = _levels[level + 1];
+        const auto& staging = *next.staging;
+        const MPI_Comm comm = layout.communicator();
+        const int      halo = gather ? 0 : 1;
+
+        const int leader_rank = _leader_rank(level);
+
+        std::deque<SubArray<T, NDIMS>> boxes;
+        std::vector<MPI_Request>    requests;
+
+        std::array<int, NDIMS> origin, size;
+        for (auto dim : LinRange(NDIMS)) {
+            origin[dim] = -halo;
+            size[dim]   = staging.size(dim) + 2*halo;
+        }
+        boxes.emplace_back(staging, origin, size);
+        requests.push_back(gather ? isend(boxes.back(), leader_rank, 0, comm)
+                                  : irecv(boxes.back(), leader_rank, 0, comm));
+
+        if (coarse != nullptr) {
+            for (const auto& member : IndexRange<NDIMS>(next.factor)) {
+                std::array<int, NDIMS> coords = layout.coords();
+                for (auto dim : LinRange(NDIMS)) {
+                    coords[dim] += member[dim];
+                    origin[dim]  = member[dim]*staging.size(dim) - halo;
+                }
+                int member_rank;
+                MPI_Cart_rank(comm, coords.data(), &member_rank);
+                boxes.emplace_back(*coarse, origin, size);
+                requests.push_back(gather ? irecv(boxes.back(), member_rank, 0, comm)
+                                          : isend(boxes.back(), member_rank, 0, comm));
+            }
+        }
+
+        MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    }
+
+    static void _check_sizes(const DArray<T, NDIMS>& fine, const DArray<T, NDIMS>& coarse) {
+        for (auto dim : LinRange(NDIMS))
+            if (fine.size(dim) != 2*coarse.size(dim))
+                throw std::invalid_argument("incompatible array sizes between levels");
+    }
+
+public:
+    // ===================================================================== //
+    // constructor from the layout and size of the finest level. Levels are
+    // added while all local sizes are even, until the number of cells per
+    // rank of the next level would drop below min_size along a dimension
+    // whose processor grid cannot be reduced any further, or max_levels is
+    // reached. All arrays have the given halo points, which must be at
+    // least one and less than min_size.
+    MultigridHierarchy(const DArrayLayout<NDIMS>& layout,
+                       std::array<int, NDIMS>     array_size,
+                       std::array<int, NDIMS>     nhalo_out,
+                       std::array<int, NDIMS>     nhalo_in,
+                       int                        min_size   = 4,
+                       int                        max_levels = 32)
+        : _nhalo_out (nhalo_out)
+        , _nhalo_in  (nhalo_in ) {
+            for (auto dim : LinRange(NDIMS))
+                if (std::min(nhalo_out[dim], nhalo_in[dim]) < 1 or
+                    std::max(nhalo_out[dim], nhalo_in[dim]) >= min_size)
+                    throw std::invalid_argument("halo points must be at least one and less than min_size");
+
+            std::array<int, NDIMS> grid;
+            for (auto dim : LinRange(NDIMS))
+                grid[dim] = layout.size(dim);
+            std::array<int, NDIMS> ones;
+            ones.fill(1);
+            _levels.push_back({std::make_unique<DArrayLayout<NDIMS>>(layout),
+                               array_size, grid, ones, nullptr});
+
+            while (static_cast<int>(_levels.size()) < max_levels) {
+                const auto& fine = _levels.back();
+
+                // size of the next level, and reduction of the processor grid
+                std::array<int, NDIMS> size, factor, local;
+                bool stop = false;
+                for (auto dim : LinRange(NDIMS)) {
+                    const int n = fine.array_size[dim] / fine.grid[dim];
+                    size[dim]   = fine.array_size[dim] / 2;
+                    factor[dim] = 1;
+                    // the staging area needs two points per rank, for a halo
+                    if (n % 2 != 0 or n < 4)
+                        stop = true;
+                    else if (n/2 < min_size)
+                        factor[dim] = _smallest_factor(fine.grid[dim]);
+                    local[dim] = n/2*factor[dim];
+                    if (local[dim] < min_size)
+                        stop = true;
+                }
+                if (stop)
+                    break;
+
+                _Level next{nullptr, size, fine.grid, factor, nullptr};
+                for (auto dim : LinRange(NDIMS))
+                    next.grid[dim] /= factor[dim];
+
+                if (fine.layout and !next.agglomerated()) {
+                    next.layout = std::make_unique<DArrayLayout<NDIMS>>(*fine.layout);
+                } else if (fine.layout) {
+                    // ranks at the corner of each group take part, in the
+                    // same cartesian order as in the grid of the finer level
+                    const auto& coords = fine.layout->coords();
+                    bool active = true;
+                    int  key    = 0;
+                    for (auto dim : LinRange(NDIMS)) {
+                        active = active and coords[dim] % factor[dim] == 0;
+                        key    = key*next.grid[dim] + coords[dim] / factor[dim];
+                    }
+                    MPI_Comm comm;
+                    MPI_Comm_split(fine.layout->communicator(),
+                                   active ? 0 : MPI_UNDEFINED, key, &comm);
+                    if (active) {
+                        std::array<int, NDIMS> is_periodic;
+                        for (auto dim : LinRange(NDIMS))
+                            is_periodic[dim] = fine.layout->is_periodic(dim);
+                        next.layout = std::make_unique<DArrayLayout<NDIMS>>(comm, next.grid, is_periodic);
+                        MPI_Comm_free(&comm);
+                    }
+
+                    std::array<int, NDIMS> one;
+                    one.fill(1);
+                    next.staging = std::make_unique<DArray<T, NDIMS>>(*fine.layout, size, one, one);
+                }
+                _levels.push_back(std::move(next));
+            }
+    }
+
+    // ===================================================================== //
+    // number of levels, the same on all ranks
+    inline int nlevels() const {
+        return _levels.size();
+    }
+
+    // ===================================================================== //
+    // whether the current rank takes part in the given level
+    inline bool active(int level) const {
+        return _levels.at(level).layout != nullptr;
+    }
+
+    // ===================================================================== //
+    // whether the given level lives on a coarser processor grid than the
+    // previous one
+    inline bool agglomerated(int level) const {
+        return _levels.at(level).agglomerated();
+    }
+
+    // ===================================================================== //
+    // layout of the given level, on ranks taking part in it
+    inline const DArrayLayout<NDIMS>& layout(int level) const {
+        if (!active(level))
+            throw std::invalid_argument("rank does not take part in this level");
+        return *_levels[level].layout;
+    }
+
+    // ===================================================================== //
+    // global array size and processor grid size of the given level
+    inline const std::array<int, NDIMS>& array_size(int level) const {
+        return _levels.at(level).array_size;
+    }
+
+    inline const std::array<int, NDIMS>& grid(int level) const {
+        return _levels.at(level).grid;
+    }
+
+    // ===================================================================== //
+    // new array for the given level, or null on ranks not taking part
+    std::unique_ptr<DArray<T, NDIMS>> make_array(int level) const {
+        if (!active(level))
+            return nullptr;
+        return std::make_unique<DArray<T, NDIMS>>(layout(level), array_size(level),
+                                                  _nhalo_out, _nhalo_in);
+    }
+
+    // ===================================================================== //
+    // set the array of level + 1 to the average of the array of the given
+    // level, i.e. full weighting for cell-centred grids. Collective over
+    // the ranks of the given level; coarse is null on ranks not taking part
+    // in level + 1.
+    void restriction(int level, const DArray<T, NDIMS>& fine, DArray<T, NDIMS>* coarse) {
+        const auto& next = _levels.at(level + 1);
+        if (!next.agglomerated()) {
+            _check_sizes(fine, *coarse);
+            _restrict_average(*coarse, fine);
+        } else {
+            _check_sizes(fine, *next.staging);
+            _restrict_average(*next.staging, fine);
+            _exchange(level, coarse, true);
+        }
+    }
+
+    // ===================================================================== //
+    // add the linear interpolation of the array of level + 1 to the array
+    // of the given level. The halo of the coarse array is swapped first, so
+    // only the halo points on the domain boundaries, including the corners
+    // that swap_halo does not update, must be set by the caller.
+    // Collective over the ranks of the given level; coarse is null on ranks
+    // not taking part in level + 1.
+    void prolongation(int level, DArray<T, NDIMS>* coarse, DArray<T, NDIMS>& fine) {
+        const auto& next = _levels.at(level + 1);
+        if (coarse != nullptr)
+            coarse->swap_halo();
+        if (!next.agglomerated()) {
+            _check_sizes(fine, *coarse);
+            _prolongate_add(fine, *coarse);
+        } else {
+            _check_sizes(fine, *next.staging);
+            _exchange(level, coarse, false);
+            _prolongate_add(fine, *next.staging);
+        }
+    }
+};
+
+}
@@ -0,0 +1,229 @@
+#pragma once
+#include <stdexcept>
+#include <vector>
+#include <deque>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Redistribution of an array between arbitrary layouts, e.g. //
+// from a 4x4x4 to an 8x8x1 processor grid, or onto a subset  //
+// of the ranks. Every rank publishes the global box of the   //
+// points it owns before and after; the intersections of the  //
+// boxes give what each pair of ranks exchanges, and all of   //
+// it moves in one MPI_Alltoallw with subarray types.         //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// global box of in-domain points: the origin and the size of the block
+// owned by a rank, with a zero size for ranks without the array
+template <size_t NDIMS>
+struct _GlobalBox {
+    std::array<int, NDIMS> origin;
+    std::array<int, NDIMS>   size;
+};
+
+template <typename T, size_t NDIMS>
+inline _GlobalBox<NDIMS> _global_box(const DArray<T, NDIMS>* a) {
+    _GlobalBox<NDIMS> box = {};
+    if (a != nullptr) {
+        box.origin = a->origin();
+        box.size   = a->size();
+    }
+    return box;
+}
+
+// intersection of two boxes, with a zero size when they do not overlap
+template <size_t NDIMS>
+inline _GlobalBox<NDIMS> _intersect(const _GlobalBox<NDIMS>& a,
+                                    const _GlobalBox<NDIMS>& b) {
+    _GlobalBox<NDIMS> box = {};
+    for (auto dim : LinRange(NDIMS)) {
+        const int lo = std::max(a.origin[dim], b.origin[dim]);
+        const int hi = std::min(a.origin[dim] + a.size[dim], b.origin[dim] + b.size[dim]);
+        if (hi <= lo)
+            return _GlobalBox<NDIMS>{};
+        box.origin[dim] = lo;
+        box.size[dim]   = hi - lo;
+    }
+    return box;
+}
+
+// ===================================================================== //
+// Redistribution: plan to copy the in-domain points of an array into an
+// array with the same global size on another layout. Both layouts must be
+// built on subsets of the ranks of the given communicator, whose ranks
+// all construct the plan, passing a null pointer for an array they do
+// not hold. Types are created once, so that it can be repeated cheaply.
+template <typename T, size_t NDIMS>
+class Redistribution {
+private:
+    std::deque<SubArray<T, NDIMS>>   _boxes; // blocks sent to and received from each rank
+    std::vector<MPI_Datatype>    _sendtypes;
+    std::vector<MPI_Datatype>    _recvtypes;
+    std::vector<int>            _sendcounts; // one of each type, none if the boxes are disjoint
+    std::vector<int>            _recvcounts;
+    std::vector<int>                _displs; // all types start at the buffer
+    T*                                _send; // buffer of the input array, if any
+    T*                                _recv; // buffer of the output array, if any
+    MPI_Comm                          _comm; // duplicate of the given communicator
+    std::vector<MPI_Request>      _requests; // of the non-blocking redistribution
+
+public:
+    // ===================================================================== //
+    // constructor from the output and input arrays, either of which can be
+    // null, and a communicator including the ranks of both layouts
+    Redistribution(DArray<T, NDIMS>* out, const DArray<T, NDIMS>* in, MPI_Comm comm)
+        : _send    (in  != nullptr ? in->data()  : nullptr)
+        , _recv    (out != nullptr ? out->data() : nullptr)
+        , _comm    (MPI_COMM_NULL) {
+            if (out != nullptr and static_cast<const void*>(out) == in)
+                throw std::invalid_argument("redistribution cannot be done in place");
+
+            int nprocs;
+            MPI_Comm_size(comm, &nprocs);
+
+            // boxes and global sizes of the two arrays on every rank
+            const auto box_in  = _global_box(in);
+            const auto box_out = _global_box(out);
+            std::array<int, 6*NDIMS> mine = {};
+            for (auto dim : LinRange(NDIMS)) {
+                mine[          dim] = box_in.origin[dim];
+                mine[  NDIMS + dim] = box_in.size[dim];
+                mine[2*NDIMS + dim] = box_out.origin[dim];
+                mine[3*NDIMS + dim] = box_out.size[dim];
+                mine[4*NDIMS + dim] = in  != nullptr ? in->array_size()[dim]  : 0;
+                mine[5*NDIMS + dim] = out != nullptr ? out->array_size()[dim] : 0;
+            }
+            std::vector<int> all(6*NDIMS*nprocs);
+            MPI_Allgather(mine.data(), 6*NDIMS, MPI_INT,
+                          all.data(),  6*NDIMS, MPI_INT, comm);
+
+            // all ranks see the same global sizes, so all throw together
+            std::array<int, NDIMS> size_in = {}, size_out = {};
+            bool consistent = true;
+            for (auto p : LinRange(nprocs)) {
+                for (auto dim : LinRange(NDIMS)) {
+                    for (auto [offset, size] : {std::pair(4*NDIMS, &size_in),
+                                                std::pair(5*NDIMS, &size_out)}) {
+                        const int n = all[6*NDIMS*p + offset + dim];
+                        if (n != 0 and (*size)[dim] != 0 and (*size)[dim] != n)
+                            consistent = false;
+                        if (n != 0)
+                            (*size)[dim] = n;
+                    }
+                }
+            }
+            if (!consistent or size_in != size_out)
+                throw std::invalid_argument("arrays must have the same global size");
+
+            // what my input box shares with the output box of rank p, and
+            // what my output box shares with the input box of rank p
+            for (auto p : LinRange(nprocs)) {
+                _GlobalBox<NDIMS> other_in, other_out;
+                for (auto dim : LinRange(NDIMS)) {
+                    other_in.origin[dim]  = all[6*NDIMS*p +           dim];
+                    other_in.size[dim]    = all[6*NDIMS*p +   NDIMS + dim];
+                    other_out.origin[dim] = all[6*NDIMS*p + 2*NDIMS + dim];
+                    other_out.size[dim]   = all[6*NDIMS*p + 3*NDIMS + dim];
+                }
+
+                const auto send = _intersect(box_in, other_out);
+                if (in != nullptr and send.size[0] != 0) {
+                    std::array<int, NDIMS> origin;
+                    for (auto dim : LinRange(NDIMS))
+                        origin[dim] = send.origin[dim] - box_in.origin[dim];
+                    _boxes.emplace_back(*in, origin, send.size);
+                    _sendtypes.push_back(_boxes.back().type());
+                    _sendcounts.push_back(1);
+                } else {
+                    _sendtypes.push_back(MPI::mpi_type<T>());
+                    _sendcounts.push_back(0);
+                }
+
+                const auto recv = _intersect(box_out, other_in);
+                if (out != nullptr and recv.size[0] != 0) {
+                    std::array<int, NDIMS> origin;
+                    for (auto dim : LinRange(NDIMS))
+                        origin[dim] = recv.origin[dim] - box_out.origin[dim];
+                    _boxes.emplace_back(*out, origin, recv.size);
+                    _recvtypes.push_back(_boxes.back().type());
+                    _recvcounts.push_back(1);
+                } else {
+                    _recvtypes.push_back(MPI::mpi_type<T>());
+                    _recvcounts.push_back(0);
+                }
+            }
+            _displs.assign(nprocs, 0);
+
+            // messages of the plan must not match those of halo swaps on the
+            // same communicator, e.g. while a redistribution is in progress
+            MPI_Comm_dup(comm, &_comm);
+    }
+
+    // ===================================================================== //
+    // constructor from arrays held by all ranks of the input communicator
+    Redistribution(DArray<T, NDIMS>& out, const DArray<T, NDIMS>& in)
+        : Redistribution(&out, &in, in.layout().communicator()) {}
+
+    // ===================================================================== //
+    // a redistribution in progress must complete before the buffers go away
+    ~Redistribution() {
+        wait();
+        MPI_Comm_free(&_comm);
+    }
+
+    Redistribution(const Redistribution&) = delete;
+    Redistribution& operator = (const Redistribution&) = delete;
+
+    // ===================================================================== //
+    // blocking redistribution
+    void execute() {
+        MPI_Alltoallw(_send, _sendcounts.data(), _displs.data(), _sendtypes.data(),
+                      _recv, _recvcounts.data(), _displs.data(), _recvtypes.data(), _comm);
+    }
+
+    // ===================================================================== //
+    // non-blocking redistribution: neither array can be used until wait()
+    // returns. As for SlabTranspose, the messages of MPI_Alltoallw are posted
+    // point to point, rather than with MPI_Ialltoallw, and only between
+    // ranks whose boxes overlap.
+    void start() {
+        const int nprocs = _displs.size();
+        _requests.clear();
+        for (auto p : LinRange(nprocs))
+            if (_recvcounts[p] != 0) {
+                _requests.emplace_back();
+                MPI_Irecv(_recv, 1, _recvtypes[p], p, 0, _comm, &_requests.back());
+            }
+        for (auto p : LinRange(nprocs))
+            if (_sendcounts[p] != 0) {
+                _requests.emplace_back();
+                MPI_Isend(_send, 1, _sendtypes[p], p, 0, _comm, &_requests.back());
+            }
+    }
+
+    bool test() {
+        int flag;
+        MPI_Testall(_requests.size(), _requests.data(), &flag, MPI_STATUSES_IGNORE);
+        return flag;
+    }
+
+    void wait() {
+        MPI_Waitall(_requests.size(), _requests.data(), MPI_STATUSES_IGNORE);
+    }
+};
+
+// ===================================================================== //
+// one-off redistribution of in into out, see Redistribution
+template <typename T, size_t NDIMS>
+void redistribute(DArray<T, NDIMS>& out, const DArray<T, NDIMS>& in) {
+    Redistribution<T, NDIMS>(out, in).execute();
+}
+
+template <typename T, size_t NDIMS>
+void redistribute(DArray<T, NDIMS>* out, const DArray<T, NDIMS>* in, MPI_Comm comm) {
+    Redistribution<T, NDIMS>(out, in, comm).execute();
+}
+
+}
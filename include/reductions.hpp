@@ -0,0 +1,321 @@
+#pragma once
+#include <stdexcept>
+#include <functional>
+#include <memory>
+#include <limits>
+#include <vector>
+#include <cmath>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Global reductions over the in-domain points of DArrays.    //
+// The local pass runs over rows, optionally on the threads   //
+// of a ThreadPool, and its result goes straight into an      //
+// MPI_Allreduce on the communicator of the layout. The i*    //
+// forms start an MPI_Iallreduce instead, so that the global  //
+// step can overlap e.g. the next halo swap.                  //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// reduce f(i) for i in [0, n) with op. Independent partial results break
+// the dependency chain, so that the loop vectorises; the association is
+// fixed, hence results do not depend on the compiler or the flags used.
+template <typename R, typename F, typename OP>
+inline R _reduce_row(int n, R init, F f, OP op) {
+    constexpr int NACC = 8;
+    R acc[NACC];
+    for (auto& v : acc)
+        v = init;
+    int i = 0;
+    for (; i + NACC <= n; i += NACC)
+        for (int j = 0; j != NACC; j++)
+            acc[j] = op(acc[j], f(i + j));
+    for (; i != n; i++)
+        acc[0] = op(acc[0], f(i));
+    for (auto v : acc)
+        init = op(init, v);
+    return init;
+}
+
+// ===================================================================== //
+// reduce rowfun(index) over the first point of all rows of the array,
+// splitting the rows among the threads of the pool, if one is given
+template <typename R, typename T, size_t NDIMS, typename OP, typename ROWFUN>
+inline R _reduce_local(const DArray<T, NDIMS>& a,
+                       ThreadPool*             pool,
+                       R                       init,
+                       OP                      op,
+                       ROWFUN                  rowfun) {
+    std::array<int, NDIMS> nrows = a.size();
+    nrows[0] = 1;
+    const IndexRange<NDIMS> rows(nrows);
+
+    if (pool == nullptr) {
+        R value = init;
+        for (const auto& index : rows)
+            value = op(value, rowfun(index));
+        return value;
+    }
+
+    std::vector<R> partial(pool->size(), init);
+    pool->run([&](int id) {
+        for (const auto& index : rows.split(id, pool->size()))
+            partial[id] = op(partial[id], rowfun(index));
+    });
+    R value = init;
+    for (auto v : partial)
+        value = op(value, v);
+    return value;
+}
+
+// ===================================================================== //
+// element-wise operations of the reductions, for real valued arrays
+struct _Plus { template <typename T> T operator () (T a, T b) const { return a + b;     } };
+struct _Max  { template <typename T> T operator () (T a, T b) const { return a < b ? b : a; } };
+struct _Min  { template <typename T> T operator () (T a, T b) const { return b < a ? b : a; } };
+
+template <typename T, size_t NDIMS, typename OP, typename F>
+inline T _reduce_local_elements(const DArray<T, NDIMS>& a, ThreadPool* pool,
+                                T init, OP op, F f) {
+    return _reduce_local(a, pool, init, op, [&](const std::array<int, NDIMS>& index) {
+        const T* p = a.row(index).data();
+        return _reduce_row(a.size(0), init, [p, f](int i) { return f(p[i]); }, op);
+    });
+}
+
+// ===================================================================== //
+// local parts of the reductions, on this rank only
+template <typename T, size_t NDIMS>
+inline T local_sum(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return _reduce_local_elements(a, pool, T(0), _Plus(), [](T x) { return x; });
+}
+
+template <typename T, size_t NDIMS>
+inline T local_max(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return _reduce_local_elements(a, pool, a.row({})[0], _Max(), [](T x) { return x; });
+}
+
+template <typename T, size_t NDIMS>
+inline T local_min(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return _reduce_local_elements(a, pool, a.row({})[0], _Min(), [](T x) { return x; });
+}
+
+template <typename T, size_t NDIMS>
+inline T local_norm1(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return _reduce_local_elements(a, pool, T(0), _Plus(), [](T x) { return std::abs(x); });
+}
+
+template <typename T, size_t NDIMS>
+inline T local_sumsq(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return _reduce_local_elements(a, pool, T(0), _Plus(), [](T x) { return x*x; });
+}
+
+template <typename T, size_t NDIMS>
+inline T local_norminf(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return _reduce_local_elements(a, pool, T(0), _Max(), [](T x) { return std::abs(x); });
+}
+
+template <typename T, size_t NDIMS>
+inline T local_dot(const DArray<T, NDIMS>& a, const DArray<T, NDIMS>& b,
+                   ThreadPool* pool = nullptr) {
+    if (a.size() != b.size())
+        throw std::invalid_argument("arrays must have the same size");
+    return _reduce_local(a, pool, T(0), _Plus(), [&](const std::array<int, NDIMS>& index) {
+        const T* pa = a.row(index).data();
+        const T* pb = b.row(index).data();
+        return _reduce_row(a.size(0), T(0), [pa, pb](int i) { return pa[i]*pb[i]; }, _Plus());
+    });
+}
+
+// ===================================================================== //
+// ReductionRequest: global reduction in progress, started at construction.
+// The value is obtained with get(), which blocks until the reduction has
+// completed. Like a halo swap, all ranks must start their reductions in
+// the same order.
+template <typename T>
+class ReductionRequest {
+private:
+    std::unique_ptr<T[]>          _buffer; // local and global values, at a fixed address
+    MPI_Request                  _request;
+    std::function<T(T)>           _finish; // applied to the global value, e.g. sqrt
+
+public:
+    ReductionRequest(T                   local,
+                     MPI_Op              op,
+                     MPI_Comm            comm,
+                     std::function<T(T)> finish = [](T x) { return x; })
+        : _buffer (new T[2]{local, local})
+        , _finish (finish) {
+            MPI_Iallreduce(&_buffer[0], &_buffer[1], 1, MPI::mpi_type<T>(),
+                           op, comm, &_request);
+    }
+
+    // ===================================================================== //
+    // the buffer must outlive the reduction
+    ~ReductionRequest() {
+        if (_buffer)
+            MPI_Wait(&_request, MPI_STATUS_IGNORE);
+    }
+
+    ReductionRequest(ReductionRequest&& other)
+        : _buffer  (std::move(other._buffer))
+        , _request (other._request)
+        , _finish  (std::move(other._finish)) {}
+
+    ReductionRequest(const ReductionRequest&) = delete;
+    ReductionRequest& operator = (const ReductionRequest&) = delete;
+
+    // ===================================================================== //
+    // whether the reduction has completed, without blocking
+    bool test() {
+        int flag;
+        MPI_Test(&_request, &flag, MPI_STATUS_IGNORE);
+        return flag;
+    }
+
+    // ===================================================================== //
+    // wait for completion and return the global value
+    T get() {
+        MPI_Wait(&_request, MPI_STATUS_IGNORE);
+        return _finish(_buffer[1]);
+    }
+};
+
+// ===================================================================== //
+// global value of a local result
+template <typename T>
+inline T _allreduce(T local, MPI_Op op, MPI_Comm comm) {
+    T global;
+    MPI_Allreduce(&local, &global, 1, MPI::mpi_type<T>(), op, comm);
+    return global;
+}
+
+// ===================================================================== //
+// global reductions, collective over the communicator of the layout. If
+// a pool is given, the local pass is split among its threads.
+template <typename T, size_t NDIMS>
+inline T sum(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return _allreduce(local_sum(a, pool), MPI_SUM, a.layout().communicator());
+}
+
+template <typename T, size_t NDIMS>
+inline T max(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return _allreduce(local_max(a, pool), MPI_MAX, a.layout().communicator());
+}
+
+template <typename T, size_t NDIMS>
+inline T min(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return _allreduce(local_min(a, pool), MPI_MIN, a.layout().communicator());
+}
+
+template <typename T, size_t NDIMS>
+inline T norm1(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return _allreduce(local_norm1(a, pool), MPI_SUM, a.layout().communicator());
+}
+
+template <typename T, size_t NDIMS>
+inline T norm2(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return std::sqrt(_allreduce(local_sumsq(a, pool), MPI_SUM, a.layout().communicator()));
+}
+
+template <typename T, size_t NDIMS>
+inline T norminf(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return _allreduce(local_norminf(a, pool), MPI_MAX, a.layout().communicator());
+}
+
+template <typename T, size_t NDIMS>
+inline T dot(const DArray<T, NDIMS>& a, const DArray<T, NDIMS>& b,
+             ThreadPool* pool = nullptr) {
+    return _allreduce(local_dot(a, b, pool), MPI_SUM, a.layout().communicator());
+}
+
+// ===================================================================== //
+// non-blocking global reductions: the local pass is done on return
+template <typename T, size_t NDIMS>
+inline ReductionRequest<T> isum(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return {local_sum(a, pool), MPI_SUM, a.layout().communicator()};
+}
+
+template <typename T, size_t NDIMS>
+inline ReductionRequest<T> imax(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return {local_max(a, pool), MPI_MAX, a.layout().communicator()};
+}
+
+template <typename T, size_t NDIMS>
+inline ReductionRequest<T> imin(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return {local_min(a, pool), MPI_MIN, a.layout().communicator()};
+}
+
+template <typename T, size_t NDIMS>
+inline ReductionRequest<T> inorm1(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return {local_norm1(a, pool), MPI_SUM, a.layout().communicator()};
+}
+
+template <typename T, size_t NDIMS>
+inline ReductionRequest<T> inorm2(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return {local_sumsq(a, pool), MPI_SUM, a.layout().communicator(),
+            [](T x) { return std::sqrt(x); }};
+}
+
+template <typename T, size_t NDIMS>
+inline ReductionRequest<T> inorminf(const DArray<T, NDIMS>& a, ThreadPool* pool = nullptr) {
+    return {local_norminf(a, pool), MPI_MAX, a.layout().communicator()};
+}
+
+template <typename T, size_t NDIMS>
+inline ReductionRequest<T> idot(const DArray<T, NDIMS>& a, const DArray<T, NDIMS>& b,
+                                ThreadPool* pool = nullptr) {
+    return {local_dot(a, b, pool), MPI_SUM, a.layout().communicator()};
+}
+
+// ===================================================================== //
+// Extremum: value of the global maximum/minimum, with the rank owning it
+// and its local index on that rank. Ties go to the lowest rank and, on
+// that rank, to the first point in memory order. Values are compared as
+// doubles across ranks, so the element type must convert to double exactly,
+// e.g. not 64-bit integers.
+template <typename T, size_t NDIMS>
+struct Extremum {
+    T                         value;
+    int                        rank;
+    std::array<int, NDIMS>    index;
+};
+
+template <typename T, size_t NDIMS, typename CMP>
+inline Extremum<T, NDIMS> _extremum(const DArray<T, NDIMS>& a, MPI_Op op, CMP better) {
+    static_assert(std::numeric_limits<T>::is_specialized
+                  and std::numeric_limits<T>::radix == 2
+                  and std::numeric_limits<T>::digits <= std::numeric_limits<double>::digits,
+                  "argmax and argmin need elements exactly representable as double");
+
+    // local pass, keeping the first best point
+    Extremum<T, NDIMS> ext = {a.row({})[0], a.layout().rank(), {}};
+    for (const auto& row : a.rows())
+        for (auto i : LinRange(row.size()))
+            if (better(row[i], ext.value)) {
+                ext.value    = row[i];
+                ext.index    = row.index();
+                ext.index[0] = i;
+            }
+
+    // find the owner, then get the index from it
+    struct { double value; int rank; } local = {double(ext.value), ext.rank}, global;
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE_INT, op, a.layout().communicator());
+    ext.value = global.value;
+    ext.rank  = global.rank;
+    MPI_Bcast(ext.index.data(), NDIMS, MPI_INT, ext.rank, a.layout().communicator());
+    return ext;
+}
+
+template <typename T, size_t NDIMS>
+inline Extremum<T, NDIMS> argmax(const DArray<T, NDIMS>& a) {
+    return _extremum(a, MPI_MAXLOC, [](T x, T best) { return x > best; });
+}
+
+template <typename T, size_t NDIMS>
+inline Extremum<T, NDIMS> argmin(const DArray<T, NDIMS>& a) {
+    return _extremum(a, MPI_MINLOC, [](T x, T best) { return x < best; });
+}
+
+}
@@ -0,0 +1,187 @@
+#pragma once
+#include <stdexcept>
+#include <vector>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Batched access to arbitrary global points of an array,     //
+// e.g. for probes or particle interpolation. The points are  //
+// grouped by owner once, when the plan is built, and every   //
+// read or write moves all of them in a single all-to-all,    //
+// instead of one message per point.                          //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// RemoteAccess: plan to read and write a list of global indices of an
+// array, which may be owned by any rank and are wrapped around periodic
+// dimensions. All ranks of the layout build the plan and call each of its
+// methods, possibly with an empty list of their own.
+template <typename T, size_t NDIMS>
+class RemoteAccess {
+private:
+    DArray<T, NDIMS>&         _array;
+    std::vector<int>          _order; // position in the list of the points, grouped by owner
+    std::vector<int>     _sendcounts; // points I request from each rank
+    std::vector<int>     _senddispls;
+    std::vector<int>     _recvcounts; // points each rank requests from me
+    std::vector<int>     _recvdispls;
+    std::vector<size_t>     _offsets; // memory offsets of the points requested from me
+    std::vector<T>          _sendbuf; // values of my points, grouped by owner
+    std::vector<T>          _recvbuf; // values of the points requested from me
+
+    // ===================================================================== //
+    // exchange values of my points with their owners, forward for writes
+    void _forward() {
+        MPI_Alltoallv(_sendbuf.data(), _sendcounts.data(), _senddispls.data(), MPI::mpi_type<T>(),
+                      _recvbuf.data(), _recvcounts.data(), _recvdispls.data(), MPI::mpi_type<T>(),
+                      _array.layout().communicator());
+    }
+
+    void _backward() {
+        MPI_Alltoallv(_recvbuf.data(), _recvcounts.data(), _recvdispls.data(), MPI::mpi_type<T>(),
+                      _sendbuf.data(), _sendcounts.data(), _senddispls.data(), MPI::mpi_type<T>(),
+                      _array.layout().communicator());
+    }
+
+public:
+    // ===================================================================== //
+    // constructor from the array and the global indices of the points
+    RemoteAccess(DArray<T, NDIMS>& array, const std::vector<std::array<int, NDIMS>>& indices)
+        : _array (array) {
+            const int nprocs = array.layout().nprocs();
+            const MPI_Comm comm = array.layout().communicator();
+
+            // group points by owner, with a counting sort that keeps their
+            // order in the list within each group
+            std::vector<int> owners(indices.size());
+            int failed = 0;
+            for (auto n : LinRange(indices.size())) {
+                try {
+                    owners[n] = array.owner(indices[n]);
+                } catch (const std::out_of_range&) {
+                    failed = 1;
+                }
+            }
+
+            // indices out of range on any rank make all ranks throw, before
+            // the others are left waiting in the exchanges below
+            MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_LOR, comm);
+            if (failed)
+                throw std::out_of_range("global index out of range");
+
+            _sendcounts.assign(nprocs, 0);
+            for (auto n : LinRange(indices.size()))
+                _sendcounts[owners[n]]++;
+            _senddispls.assign(nprocs, 0);
+            for (auto p : LinRange(1, nprocs))
+                _senddispls[p] = _senddispls[p-1] + _sendcounts[p-1];
+
+            _order.resize(indices.size());
+            std::vector<int> next = _senddispls;
+            for (auto n : LinRange(indices.size()))
+                _order[next[owners[n]]++] = n;
+
+            // tell owners which points they are asked for
+            _recvcounts.resize(nprocs);
+            MPI_Alltoall(_sendcounts.data(), 1, MPI_INT,
+                         _recvcounts.data(), 1, MPI_INT, comm);
+            _recvdispls.assign(nprocs, 0);
+            for (auto p : LinRange(1, nprocs))
+                _recvdispls[p] = _recvdispls[p-1] + _recvcounts[p-1];
+            const int nrecv = _recvdispls[nprocs-1] + _recvcounts[nprocs-1];
+
+            std::vector<int> sendidx(NDIMS*indices.size());
+            for (auto m : LinRange(indices.size())) {
+                const auto wrapped = array.wrap_index(indices[_order[m]]);
+                std::copy(wrapped.begin(), wrapped.end(), sendidx.begin() + NDIMS*m);
+            }
+            std::vector<int> recvidx(NDIMS*nrecv);
+            std::vector<int> sendcounts(nprocs), senddispls(nprocs);
+            std::vector<int> recvcounts(nprocs), recvdispls(nprocs);
+            for (auto p : LinRange(nprocs)) {
+                sendcounts[p] = NDIMS*_sendcounts[p]; senddispls[p] = NDIMS*_senddispls[p];
+                recvcounts[p] = NDIMS*_recvcounts[p]; recvdispls[p] = NDIMS*_recvdispls[p];
+            }
+            MPI_Alltoallv(sendidx.data(), sendcounts.data(), senddispls.data(), MPI_INT,
+                          recvidx.data(), recvcounts.data(), recvdispls.data(), MPI_INT, comm);
+
+            // memory offsets of the points I own
+            _offsets.resize(nrecv);
+            for (auto m : LinRange(nrecv)) {
+                std::array<int, NDIMS> index;
+                std::copy(recvidx.begin() + NDIMS*m, recvidx.begin() + NDIMS*(m + 1), index.begin());
+                _offsets[m] = array.linear_index(array.local_index(index));
+            }
+
+            _sendbuf.resize(indices.size());
+            _recvbuf.resize(nrecv);
+    }
+
+    // ===================================================================== //
+    // number of points in my list
+    inline size_t size() const {
+        return _order.size();
+    }
+
+    // ===================================================================== //
+    // read the points into values, in the order of the list
+    void get(T* values) {
+        const T* data = _array.data();
+        for (auto m : LinRange(_offsets.size()))
+            _recvbuf[m] = data[_offsets[m]];
+        _backward();
+        for (auto m : LinRange(_order.size()))
+            values[_order[m]] = _sendbuf[m];
+    }
+
+    std::vector<T> get() {
+        std::vector<T> values(size());
+        get(values.data());
+        return values;
+    }
+
+    // ===================================================================== //
+    // write values to the points. If several ranks write to the same point,
+    // the value from the highest rank is kept, and within a rank, that last
+    // in the list.
+    void put(const T* values) {
+        for (auto m : LinRange(_order.size()))
+            _sendbuf[m] = values[_order[m]];
+        _forward();
+        T* data = _array.data();
+        for (auto m : LinRange(_offsets.size()))
+            data[_offsets[m]] = _recvbuf[m];
+    }
+
+    // ===================================================================== //
+    // add values to the points, summing all the contributions to a point
+    void accumulate(const T* values) {
+        for (auto m : LinRange(_order.size()))
+            _sendbuf[m] = values[_order[m]];
+        _forward();
+        T* data = _array.data();
+        for (auto m : LinRange(_offsets.size()))
+            data[_offsets[m]] += _recvbuf[m];
+    }
+};
+
+// ===================================================================== //
+// one-off batched read and write of global points, see RemoteAccess
+template <typename T, size_t NDIMS>
+std::vector<T> get(DArray<T, NDIMS>& array, const std::vector<std::array<int, NDIMS>>& indices) {
+    return RemoteAccess<T, NDIMS>(array, indices).get();
+}
+
+template <typename T, size_t NDIMS>
+void put(DArray<T, NDIMS>& array, const std::vector<std::array<int, NDIMS>>& indices,
+         const std::vector<T>& values) {
+    // a mismatch on any rank makes all ranks throw, before the exchanges
+    int failed = values.size() != indices.size();
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_LOR, array.layout().communicator());
+    if (failed)
+        throw std::invalid_argument("number of values and points must match");
+    RemoteAccess<T, NDIMS>(array, indices).put(values.data());
+}
+
+}
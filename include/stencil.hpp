@@ -0,0 +1,306 @@
+#pragma once
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include <array>
+
+namespace DArrays {
+
+// forward declaration
+template <typename T, size_t NDIMS> class DArray;
+
+////////////////////////////////////////////////////////////////
+// Stencil application. The output is computed row by row     //
+// along the contiguous dimension 0, with neighbour offsets   //
+// converted once to linear memory offsets, so that the inner //
+// loop is a plain pointer loop that compilers vectorize.     //
+// Sweeps can be blocked in space (tiles) and in time.        //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// Stencil: fixed number of points with their offsets and coefficients
+template <typename T, size_t NDIMS, size_t NPOINTS>
+class Stencil {
+private:
+    std::array<std::array<int, NDIMS>, NPOINTS> _offsets; // offsets of the points
+    std::array<T, NPOINTS>                       _coeffs; // weight of each point
+
+public:
+    // ===================================================================== //
+    // constructor
+    Stencil(const std::array<std::array<int, NDIMS>, NPOINTS>& offsets,
+            const std::array<T, NPOINTS>&                       coeffs)
+        : _offsets (offsets)
+        , _coeffs  (coeffs ) {}
+
+    // ===================================================================== //
+    // offsets and coefficients
+    inline const std::array<std::array<int, NDIMS>, NPOINTS>& offsets() const {
+        return _offsets;
+    }
+
+    inline const std::array<T, NPOINTS>& coeffs() const {
+        return _coeffs;
+    }
+
+    // ===================================================================== //
+    // number of halo points required at a boundary along dimension dim
+    inline int width(Boundary bnd, size_t dim) const {
+        #if DARRAY_LAYOUT_CHECKBOUNDS
+            _checkdims(dim, NDIMS);
+        #endif
+        int w = 0;
+        for (const auto& offset : _offsets) {
+            if (bnd == Boundary::LEFT)  w = std::max(w, -offset[dim]);
+            if (bnd == Boundary::RIGHT) w = std::max(w,  offset[dim]);
+        }
+        return w;
+    }
+};
+
+// ===================================================================== //
+// standard second order discrete laplacians on a unit spacing grid
+template <typename T>
+inline Stencil<T, 3, 7> laplacian_7pt() {
+    return {{{{ 0,  0,  0},
+              {-1,  0,  0}, {1, 0, 0},
+              { 0, -1,  0}, {0, 1, 0},
+              { 0,  0, -1}, {0, 0, 1}}},
+            {-6, 1, 1, 1, 1, 1, 1}};
+}
+
+template <typename T>
+inline Stencil<T, 3, 19> laplacian_19pt() {
+    std::array<std::array<int, 3>, 19> offsets;
+    std::array<T, 19>                  coeffs;
+    size_t n = 0;
+    for (int k : {-1, 0, 1})
+        for (int j : {-1, 0, 1})
+            for (int i : {-1, 0, 1}) {
+                int dist = std::abs(i) + std::abs(j) + std::abs(k);
+                if (dist == 3)
+                    continue;
+                offsets[n] = {i, j, k};
+                coeffs[n]  = dist == 0 ? T(-4) : dist == 1 ? T(1)/3 : T(1)/6;
+                n++;
+            }
+    return {offsets, coeffs};
+}
+
+template <typename T>
+inline Stencil<T, 3, 27> laplacian_27pt() {
+    std::array<std::array<int, 3>, 27> offsets;
+    std::array<T, 27>                  coeffs;
+    const std::array<T, 4> weights = {T(-128)/30, T(14)/30, T(3)/30, T(1)/30};
+    size_t n = 0;
+    for (int k : {-1, 0, 1})
+        for (int j : {-1, 0, 1})
+            for (int i : {-1, 0, 1}) {
+                offsets[n] = {i, j, k};
+                coeffs[n]  = weights[std::abs(i) + std::abs(j) + std::abs(k)];
+                n++;
+            }
+    return {offsets, coeffs};
+}
+
+// ===================================================================== //
+// Neighbourhood: accessor to the points around a given point of a DArray,
+// passed to user defined stencil kernels
+template <typename T, size_t NDIMS>
+using Neighbourhood = Cursor<const T, NDIMS>;
+
+// ===================================================================== //
+// check that out and in can be used together with a stencil of given width
+template <typename T, size_t NDIMS, typename WIDTH>
+inline void _check_stencil_args(const DArray<T, NDIMS>& out,
+                                const DArray<T, NDIMS>& in,
+                                WIDTH                   width) {
+    if (&out == &in)
+        throw std::invalid_argument("stencil input and output must be different arrays");
+    if (out.size() != in.size())
+        throw std::invalid_argument("incompatible array sizes in stencil application");
+    for (auto dim : LinRange(NDIMS))
+        for (auto bnd : {Boundary::LEFT, Boundary::RIGHT})
+            if (width(bnd, dim) > in.nhalo_points(bnd, dim))
+                throw std::out_of_range("stencil wider than number of halo points");
+}
+
+// ===================================================================== //
+// copy a box of given size between two buffers. Pointers refer to the
+// first point of the box, in buffers with possibly different strides.
+template <typename T, size_t NDIMS>
+void _copy_box(T*                            dst,
+               const std::array<int, NDIMS>& dst_strides,
+               const T*                      src,
+               const std::array<int, NDIMS>& src_strides,
+               const std::array<int, NDIMS>& size) {
+    std::array<int, NDIMS> nrows = size; nrows[0] = 1;
+    for (auto index : IndexRange<NDIMS>(nrows))
+        std::copy(src + _dot(index, src_strides),
+                  src + _dot(index, src_strides) + size[0],
+                  dst + _dot(index, dst_strides));
+}
+
+// ===================================================================== //
+// apply a stencil with constant coefficients over a box of given size.
+// Pointers refer to the first point of the box, as in _copy_box.
+template <typename T, size_t NDIMS, size_t NPOINTS>
+void _apply_stencil_box(T*                                out,
+                        const std::array<int, NDIMS>&     out_strides,
+                        const T*                          in,
+                        const std::array<int, NDIMS>&     in_strides,
+                        const Stencil<T, NDIMS, NPOINTS>& stencil,
+                        const std::array<int, NDIMS>&     size) {
+    // linear memory offsets of the stencil points
+    std::array<int, NPOINTS> offsets;
+    for (auto p : LinRange(NPOINTS))
+        offsets[p] = _dot(stencil.offsets()[p], in_strides);
+    const std::array<T, NPOINTS> coeffs = stencil.coeffs();
+
+    std::array<int, NDIMS> nrows = size; nrows[0] = 1;
+    for (auto index : IndexRange<NDIMS>(nrows)) {
+        T*       __restrict__ o = out + _dot(index, out_strides);
+        const T* __restrict__ p = in  + _dot(index, in_strides);
+        // accumulate one stencil point at a time over the row, which
+        // stays in cache and keeps each inner loop trivially vectorizable
+        for (int i = 0; i != size[0]; i++)
+            o[i] = coeffs[0]*p[offsets[0] + i];
+        for (size_t n = 1; n != NPOINTS; n++)
+            for (int i = 0; i != size[0]; i++)
+                o[i] += coeffs[n]*p[offsets[n] + i];
+    }
+}
+
+// ===================================================================== //
+// apply a stencil with constant coefficients, out = sum_p c_p in(x + o_p)
+template <typename T, size_t NDIMS, size_t NPOINTS>
+void apply_stencil(DArray<T, NDIMS>&                 out,
+                   const DArray<T, NDIMS>&           in,
+                   const Stencil<T, NDIMS, NPOINTS>& stencil) {
+    _check_stencil_args(out, in, [&](Boundary bnd, size_t dim) {
+        return stencil.width(bnd, dim); });
+
+    const std::array<int, NDIMS> origin = {0};
+    _apply_stencil_box(out.data() + out.linear_index(origin), out.strides(),
+                       in.data()  + in.linear_index(origin),  in.strides(),
+                       stencil, in.size());
+}
+
+// ===================================================================== //
+// as above, sweeping the domain tile by tile to keep the working set of
+// the stencil in cache. Tiles of full rows, i.e. with tile_shape[0] equal
+// to the local size, keep the longest vectorized inner loops.
+template <typename T, size_t NDIMS, size_t NPOINTS>
+void apply_stencil(DArray<T, NDIMS>&                 out,
+                   const DArray<T, NDIMS>&           in,
+                   const Stencil<T, NDIMS, NPOINTS>& stencil,
+                   std::array<int, NDIMS>            tile_shape) {
+    _check_stencil_args(out, in, [&](Boundary bnd, size_t dim) {
+        return stencil.width(bnd, dim); });
+
+    for (auto tile : out.tiles(tile_shape))
+        _apply_stencil_box(out.data() + out.linear_index(tile.origin()), out.strides(),
+                           in.data()  + in.linear_index(tile.origin()),  in.strides(),
+                           stencil, tile.size());
+}
+
+// ===================================================================== //
+// apply a stencil nsteps times, out = S^nsteps(in), with temporal blocking.
+// This is equivalent to nsteps calls to apply_stencil, each followed by a
+// swap_halo, but each tile is advanced by nsteps at once in a buffer that
+// stays in cache. The halo on sides with a neighbour must be nsteps times
+// as wide as the stencil, and it is updated redundantly by the tiles next
+// to it (overlapped tiling). The halo on sides without a neighbour holds
+// boundary values that are kept fixed during the steps; where it overlaps
+// the halo of another dimension it must hold the same values as the rank
+// on the other side, since swap_halo does not exchange these corners. The
+// halo of the output is not updated.
+template <typename T, size_t NDIMS, size_t NPOINTS>
+void apply_stencil_steps(DArray<T, NDIMS>&                 out,
+                         const DArray<T, NDIMS>&           in,
+                         const Stencil<T, NDIMS, NPOINTS>& stencil,
+                         int                               nsteps,
+                         std::array<int, NDIMS>            tile_shape) {
+    if (nsteps < 1)
+        throw std::invalid_argument("number of steps must be positive");
+
+    _check_stencil_args(out, in, [&](Boundary bnd, size_t dim) {
+        return stencil.width(bnd, dim)*(in.layout().has_neighbour_at(bnd, dim) ? nsteps : 1); });
+
+    // stencil widths and extent of the input, including halo points
+    std::array<int, NDIMS> wl, wr, raw_lo, raw_hi;
+    for (auto dim : LinRange(NDIMS)) {
+        wl[dim]     = stencil.width(Boundary::LEFT,  dim);
+        wr[dim]     = stencil.width(Boundary::RIGHT, dim);
+        raw_lo[dim] = -in.nhalo_points(Boundary::LEFT, dim);
+        raw_hi[dim] =  in.nhalo_points(Boundary::RIGHT, dim) + in.size(dim);
+    }
+
+    std::array<std::vector<T>, 2> bufs;
+    for (auto tile : out.tiles(tile_shape)) {
+        // box of the input on which this tile depends
+        std::array<int, NDIMS> box_lo, box_size, box_strides;
+        for (auto dim : LinRange(NDIMS)) {
+            box_lo[dim]   = std::max(tile.origin(dim) - nsteps*wl[dim], raw_lo[dim]);
+            box_size[dim] = std::min(tile.origin(dim) + tile.size(dim) + nsteps*wr[dim],
+                                     raw_hi[dim]) - box_lo[dim];
+        }
+        box_strides[0] = 1;
+        for (auto dim : LinRange(1, NDIMS))
+            box_strides[dim] = box_strides[dim-1]*box_size[dim-1];
+
+        // copy the input in both buffers, so both hold the fixed boundary values
+        for (auto& buf : bufs) {
+            buf.resize(box_strides[NDIMS-1]*box_size[NDIMS-1]);
+            _copy_box(buf.data(), box_strides,
+                      in.data() + in.linear_index(box_lo), in.strides(), box_size);
+        }
+
+        for (auto step : LinRange(1, nsteps + 1)) {
+            // points updated at this step: the tile, extended by the points
+            // needed by the remaining steps, on sides with a neighbour
+            std::array<int, NDIMS> lo, size;
+            for (auto dim : LinRange(NDIMS)) {
+                int _lo = tile.origin(dim) - (nsteps - step)*wl[dim];
+                int _hi = tile.origin(dim) + tile.size(dim) + (nsteps - step)*wr[dim];
+                if (!in.layout().has_neighbour_at(Boundary::LEFT, dim))
+                    _lo = std::max(_lo, 0);
+                if (!in.layout().has_neighbour_at(Boundary::RIGHT, dim))
+                    _hi = std::min(_hi, in.size(dim));
+                lo[dim]   = _lo - box_lo[dim];
+                size[dim] = _hi - _lo;
+            }
+            _apply_stencil_box(bufs[step%2].data()     + _dot(lo, box_strides), box_strides,
+                               bufs[(step-1)%2].data() + _dot(lo, box_strides), box_strides,
+                               stencil, size);
+        }
+
+        // copy the tile to the output
+        std::array<int, NDIMS> lo;
+        for (auto dim : LinRange(NDIMS))
+            lo[dim] = tile.origin(dim) - box_lo[dim];
+        _copy_box(out.data() + out.linear_index(tile.origin()), out.strides(),
+                  bufs[nsteps%2].data() + _dot(lo, box_strides), box_strides,
+                  tile.size());
+    }
+}
+
+// ===================================================================== //
+// apply a user defined kernel, out(x) = kernel(Neighbourhood of in at x).
+// The kernel must not read further than width points from the centre.
+template <typename T, size_t NDIMS, typename KERNEL>
+void apply_stencil(DArray<T, NDIMS>&       out,
+                   const DArray<T, NDIMS>& in,
+                   KERNEL                  kernel,
+                   int                     width = 1) {
+    _check_stencil_args(out, in, [&](Boundary, size_t) { return width; });
+
+    for (const auto& row : in.rows()) {
+        T* __restrict__ o = out.row(row.index()).data();
+        Neighbourhood<T, NDIMS> n = row.cursor();
+        for (int i = 0; i != row.size(); i++, ++n)
+            o[i] = kernel(n);
+    }
+}
+
+}
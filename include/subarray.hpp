@@ -1,5 +1,7 @@
 #pragma once
 #include "darray.hpp"
+#include "mpiwrapper.hpp"
+#include <vector>
 
 namespace DArrays {
 
@@ -14,29 +16,49 @@ private:
     std::array<int, NDIMS>   _raw_origin; // origin within the raw array
     const DArray<T, NDIMS>&      _parent; // handle to parent array
     std::array<int, NDIMS>         _size; // size of the SubArray
+    int                          _parity; // parity of the sum of the local indices
+                                          // of the points included, -1 for all points
     MPI_Datatype                   _type;
 
     // ===================================================================== //    
-    // init subarray type
+    // init subarray type. Regions of one colour are described by the
+    // offsets of their points in the raw array
     void _init_type(MPI_Datatype type) {
-        MPI_Type_create_subarray(NDIMS,
-                                 _parent.raw_size().data(),
-                                 _size.data(),             
-                                 _raw_origin.data(),       
-                                 MPI_ORDER_FORTRAN,                
-                                 MPI_DOUBLE, &_type);
+        if (_parity < 0) {
+            MPI_Type_create_subarray(NDIMS,
+                                     _parent.raw_size().data(),
+                                     _size.data(),             
+                                     _raw_origin.data(),       
+                                     MPI_ORDER_FORTRAN,                
+                                     MPI::mpi_type<T>(), &_type);
+        } else {
+            int shift = 0;
+            for (auto dim : LinRange(NDIMS))
+                shift += _parent.nhalo_points(Boundary::LEFT, dim);
+
+            std::vector<int> offsets;
+            const auto strides = _parent.strides();
+            for (const auto& index : ColouredIndexRange<NDIMS>(_raw_origin, _size, _parity + shift))
+                offsets.push_back(_dot(index, strides));
+            MPI_Type_create_indexed_block(offsets.size(), 1, offsets.data(),
+                                          MPI::mpi_type<T>(), &_type);
+        }
         MPI_Type_commit(&_type);
     }
     
 public:                        
     // ===================================================================== //                
-    // constructor from halo region specification and intent
+    // constructor from halo region specification and intent. If a parity
+    // is given, only the points whose local indices sum to a number with
+    // that parity are included, e.g. for a red-black halo swap
     SubArray(DArray<T, NDIMS>&            parent, 
              const HaloRegionSpec<NDIMS>& spec,  
-             HaloIntent                   intent) 
+             HaloIntent                   intent,
+             int                          parity = -1) 
         : _raw_origin ({0})
         , _parent     (parent)
-        , _size       ({0}) {
+        , _size       ({0})
+        , _parity     (parity) {
             // construct the size and origin for the case where we want to SEND the data
             for ( auto dim : LinRange(NDIMS) ) {
                 _size[dim] = _parent.nhalo_points(spec[dim], dim);
@@ -71,6 +93,20 @@ public:
             _init_type(_type); 
     }
 
+    // ===================================================================== //
+    // constructor from a box of local indices, which may extend into the halo
+    SubArray(const DArray<T, NDIMS>&       parent,
+             const std::array<int, NDIMS>& origin,
+             const std::array<int, NDIMS>& size)
+        : _raw_origin (origin)
+        , _parent     (parent)
+        , _size       (size)
+        , _parity     (-1) {
+            for (auto dim : LinRange(NDIMS))
+                _raw_origin[dim] += _parent.nhalo_points(Boundary::LEFT, dim);
+            _init_type(_type);
+    }
+
     // ===================================================================== //    
     // destructor
     ~SubArray() {
@@ -82,7 +118,8 @@ public:
     SubArray(const SubArray& reg) 
         : _raw_origin (reg.raw_origin())
         , _parent     (reg.parent())
-        , _size       (reg.size()) {
+        , _size       (reg.size())
+        , _parity     (reg._parity) {
             _init_type(_type);
     }
 
@@ -0,0 +1,193 @@
+#pragma once
+#include <functional>
+#include <exception>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Task-based execution with work stealing. Tasks become      //
+// ready when all the events they depend on, e.g. the arrival //
+// of a halo region, have been signalled. Each thread of a    //
+// ThreadPool runs tasks from its own queue and steals from   //
+// the others when it runs out of work.                       //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// TaskGraph: set of tasks with dependencies on events
+class TaskGraph {
+private:
+    struct _Task {
+        std::function<void()>   fun; // work to be done
+        std::atomic<int>      ndeps; // number of events not signalled yet
+        _Task(std::function<void()> f, int n) : fun (f), ndeps (n) {}
+    };
+
+    struct _Queue {
+        std::mutex       mutex;
+        std::deque<int>  tasks; // owner takes from the back, thieves from the front
+    };
+
+    std::deque<_Task>                          _tasks; // all tasks, stable addresses
+    std::vector<std::vector<int>>            _waiting; // tasks depending on each event
+    std::vector<std::unique_ptr<_Queue>>      _queues; // ready tasks, one queue per thread
+    std::atomic<long>                      _remaining; // tasks not yet completed
+    std::exception_ptr                     _exception; // first exception thrown by a task
+    std::mutex                                 _mutex; // protects _exception
+
+    inline void _push(int id, int task) {
+        std::lock_guard<std::mutex> lock(_queues[id]->mutex);
+        _queues[id]->tasks.push_back(task);
+    }
+
+    inline bool _pop(int id, int& task) {
+        std::lock_guard<std::mutex> lock(_queues[id]->mutex);
+        if (_queues[id]->tasks.empty())
+            return false;
+        task = _queues[id]->tasks.back();
+        _queues[id]->tasks.pop_back();
+        return true;
+    }
+
+    inline bool _steal(int id, int& task) {
+        const int nqueues = _queues.size();
+        for (auto n : LinRange(1, nqueues)) {
+            auto& victim = *_queues[(id + n) % nqueues];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline void _run(int task) {
+        try {
+            _tasks[task].fun();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_exception)
+                _exception = std::current_exception();
+        }
+        _remaining--;
+    }
+
+public:
+    TaskGraph() : _remaining (0) {}
+
+    // ===================================================================== //
+    // create a new event, returning its identifier
+    int add_event() {
+        _waiting.emplace_back();
+        return _waiting.size() - 1;
+    }
+
+    // ===================================================================== //
+    // add a task that can run once all the given events have been signalled
+    int add_task(std::function<void()> fun, const std::vector<int>& events = {}) {
+        _tasks.emplace_back(fun, events.size());
+        for (auto event : events)
+            _waiting.at(event).push_back(_tasks.size() - 1);
+        return _tasks.size() - 1;
+    }
+
+    // ===================================================================== //
+    // mark event as happened, releasing the tasks waiting for it. This must
+    // only be called from the poll function passed to execute.
+    void signal(int event) {
+        for (auto task : _waiting.at(event))
+            if (--_tasks[task].ndeps == 0)
+                _push(0, task);
+    }
+
+    // ===================================================================== //
+    // run all tasks on the threads of the pool. The calling thread, thread 0,
+    // calls poll() between tasks until it returns true, meaning that all
+    // events have been signalled. Exceptions thrown by tasks are rethrown
+    // once all tasks have completed.
+    template <typename POLL>
+    void execute(ThreadPool& pool, POLL poll) {
+        // ready tasks are split in contiguous blocks, for locality
+        _queues.clear();
+        for (int n = 0; n != pool.size(); n++)
+            _queues.emplace_back(new _Queue());
+
+        std::vector<int> ready;
+        for (auto task : LinRange(_tasks.size()))
+            if (_tasks[task].ndeps == 0)
+                ready.push_back(task);
+        for (auto n : LinRange(ready.size()))
+            _queues[n*pool.size()/ready.size()]->tasks.push_back(ready[n]);
+
+        _remaining = _tasks.size();
+        _exception = nullptr;
+        pool.run([&](int id) {
+            bool polled = id != 0;
+            int  task;
+            while (_remaining > 0 or !polled) {
+                if (!polled)
+                    polled = poll();
+                if (_pop(id, task) or _steal(id, task))
+                    _run(task);
+                else
+                    std::this_thread::yield();
+            }
+        });
+
+        if (_exception)
+            std::rethrow_exception(_exception);
+    }
+
+    void execute(ThreadPool& pool) {
+        execute(pool, [] { return true; });
+    }
+};
+
+// ===================================================================== //
+// call f(tile) on all tiles of the array while its halo is being swapped.
+// Tiles further than width points from the domain boundaries run straight
+// away, the others as soon as the halo regions they need have arrived.
+// As with HaloSwap, the corner points of the halo are not updated.
+template <typename T, size_t NDIMS, typename F>
+void parallel_for_halo(ThreadPool&            pool,
+                       DArray<T, NDIMS>&      a,
+                       std::array<int, NDIMS> tile_shape,
+                       int                    width,
+                       F                      f) {
+    TaskGraph graph;
+
+    // one event per halo region, ordered as (dim, LEFT), (dim, RIGHT)
+    std::array<int, 2*NDIMS> events;
+    for (auto& event : events)
+        event = graph.add_event();
+
+    for (auto tile : a.tiles(tile_shape)) {
+        std::vector<int> deps;
+        for (auto dim : LinRange(NDIMS)) {
+            if (tile.origin(dim) < width)
+                deps.push_back(events[2*dim]);
+            if (tile.origin(dim) + tile.size(dim) > a.size(dim) - width)
+                deps.push_back(events[2*dim + 1]);
+        }
+        graph.add_task([tile, &f] { f(tile); }, deps);
+    }
+
+    HaloSwap<T, NDIMS> swap(a);
+    graph.execute(pool, [&] {
+        for (const auto& spec : swap.test())
+            for (auto dim : LinRange(NDIMS)) {
+                if (spec[dim] == Boundary::LEFT)  graph.signal(events[2*dim]);
+                if (spec[dim] == Boundary::RIGHT) graph.signal(events[2*dim + 1]);
+            }
+        return swap.done();
+    });
+}
+
+}
@@ -0,0 +1,195 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include <mutex>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Thread-parallel loops over index ranges. A ThreadPool runs //
+// a function on all its threads and waits for completion,    //
+// like an OpenMP parallel region. Work is partitioned        //
+// statically, so the same thread always touches the same    //
+// memory and pages stay local to the socket that first       //
+// touched them (see first_touch).                            //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// ThreadPool: fixed set of persistent threads. The calling thread takes
+// part in the work as thread 0, so MPI calls made by thread 0 only
+// require the MPI_THREAD_FUNNELED support level.
+class ThreadPool {
+private:
+    std::vector<std::thread>    _workers; // threads 1 to size - 1
+    std::function<void(int)>        _job; // function being run
+    std::exception_ptr        _exception; // first exception thrown by the job
+    std::mutex                    _mutex;
+    std::condition_variable   _cv_start;
+    std::condition_variable    _cv_done;
+    long                     _generation; // number of jobs started
+    int                         _running; // number of workers still running the job
+    bool                           _stop;
+
+    void _run_job(int id) {
+        try {
+            _job(id);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_exception)
+                _exception = std::current_exception();
+        }
+    }
+
+    void _worker_loop(int id) {
+        long generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv_start.wait(lock, [&] { return _stop or _generation != generation; });
+                if (_stop)
+                    return;
+                generation = _generation;
+            }
+            _run_job(id);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (--_running == 0)
+                    _cv_done.notify_one();
+            }
+        }
+    }
+
+public:
+    // ===================================================================== //
+    // constructor/destructor
+    explicit ThreadPool(int nthreads = std::thread::hardware_concurrency())
+        : _generation (0)
+        , _running    (0)
+        , _stop       (false) {
+            if (nthreads < 1)
+                throw std::invalid_argument("number of threads must be positive");
+            for (auto id : LinRange(1, nthreads))
+                _workers.emplace_back([this, id] { _worker_loop(id); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv_start.notify_all();
+        for (auto& worker : _workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator = (const ThreadPool&) = delete;
+
+    // ===================================================================== //
+    // number of threads, including the calling thread
+    inline int size() const {
+        return _workers.size() + 1;
+    }
+
+    // ===================================================================== //
+    // run f(thread_id) on all threads and wait. Exceptions thrown by any
+    // thread are rethrown on the calling thread.
+    template <typename F>
+    void run(F f) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _job       = f;
+            _exception = nullptr;
+            _running   = _workers.size();
+            _generation++;
+        }
+        _cv_start.notify_all();
+        _run_job(0);
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv_done.wait(lock, [&] { return _running == 0; });
+        }
+        if (_exception)
+            std::rethrow_exception(_exception);
+    }
+};
+
+// ===================================================================== //
+// static partition of an index range in nparts blocks along the last,
+// slowest varying, dimension
+template <size_t NDIMS>
+inline IndexRange<NDIMS> block(const IndexRange<NDIMS>& range, int part, int nparts) {
+    std::array<int, NDIMS> origin = range.origin();
+    std::array<int, NDIMS> size   = range.size();
+    long n = size[NDIMS-1];
+    origin[NDIMS-1] += n*part/nparts;
+    size[NDIMS-1]    = n*(part + 1)/nparts - n*part/nparts;
+    return IndexRange<NDIMS>(origin, size);
+}
+
+// ===================================================================== //
+// call f(index) for all indices in the range, each thread taking a block
+template <size_t NDIMS, typename F>
+void parallel_for(ThreadPool& pool, IndexRange<NDIMS> range, F f) {
+    pool.run([&](int id) {
+        for (const auto& index : block(range, id, pool.size()))
+            f(index);
+    });
+}
+
+// ===================================================================== //
+// call f(tile) for all tiles, each thread taking a contiguous set of tiles
+template <size_t NDIMS, typename F>
+void parallel_for(ThreadPool& pool, const TileRange<NDIMS>& tiles, F f) {
+    const long ntiles = std::accumulate(tiles.ntiles().begin(), tiles.ntiles().end(),
+                                        1L, std::multiplies<>());
+    pool.run([&](int id) {
+        const long first = ntiles*id/pool.size();
+        const long last  = ntiles*(id + 1)/pool.size();
+        auto position = IndexRange<NDIMS>(tiles.ntiles()).begin(); position += first;
+        for (long n = first; n != last; n++, ++position)
+            f(tiles.tile(*position));
+    });
+}
+
+// ===================================================================== //
+// run comm() on the calling thread, typically a swap_halo, while the other
+// threads call f(index) on their block of the range; the calling thread
+// then does its own block. Blocks are those of parallel_for and
+// first_touch, so that threads work on the memory they placed. The range
+// must not depend on the data being communicated.
+template <size_t NDIMS, typename COMM, typename F>
+void parallel_for_overlap(ThreadPool& pool, COMM comm, IndexRange<NDIMS> range, F f) {
+    pool.run([&](int id) {
+        if (id == 0)
+            comm();
+        for (const auto& index : block(range, id, pool.size()))
+            f(index);
+    });
+}
+
+// ===================================================================== //
+// set all elements, halo included, to the given value using the same
+// static partition along the last dimension as parallel_for, so that with
+// first-touch page placement the memory is local to the thread using it.
+// The halo slabs along the last dimension go to the first and last thread.
+template <typename T, size_t NDIMS>
+void first_touch(ThreadPool&                             pool,
+                 DArray<T, NDIMS>&                       a,
+                 typename DArray<T, NDIMS>::value_type value = T()) {
+    const size_t nslab = a.nelements()/a.raw_size()[NDIMS-1];
+    const int    left  = a.nhalo_points(Boundary::LEFT, NDIMS-1);
+    pool.run([&](int id) {
+        const auto slabs = block(IndexRange<1>(a.size(NDIMS-1)), id, pool.size());
+        const long first = id == 0               ? 0 : left + slabs.origin()[0];
+        const long last  = id == pool.size() - 1 ? a.raw_size()[NDIMS-1]
+                                                 : left + slabs.origin()[0] + slabs.size()[0];
+        std::fill(a.data() + nslab*first, a.data() + nslab*last, value);
+    });
+}
+
+}
@@ -0,0 +1,274 @@
+#pragma once
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mpi.h>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Timeline tracing. While tracing is on, regions of code     //
+// such as halo swaps, their messages, packing, waiting and   //
+// user annotated compute phases are timestamped into a ring  //
+// buffer of each rank, keeping the most recent events. At    //
+// the end of the run, the events of all ranks are written to //
+// a Chrome trace JSON file, which Perfetto also reads, with  //
+// the clocks of the ranks aligned to that of the first rank. //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// region of code on a thread of a rank, with times from MPI_Wtime. Names
+// and categories are not copied: they must be string literals, or outlive
+// the trace.
+struct TraceEvent {
+    const char*      name;
+    const char*  category; // e.g. "halo", "transpose" or "user"
+    double          begin;
+    double            end;
+    size_t            tid; // thread, hashed
+};
+
+// ===================================================================== //
+// Tracer: ring buffer of the events of this rank. Tracing is off until
+// start() is called, and regions then cost two calls to MPI_Wtime.
+class Tracer {
+private:
+    std::vector<TraceEvent>  _events;
+    std::atomic<size_t>        _next; // number of events recorded since start
+    std::atomic<bool>       _enabled;
+
+    Tracer()
+        : _next    (0)
+        , _enabled (false) {}
+
+public:
+    // the tracer of this rank
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator = (const Tracer&) = delete;
+
+    // ===================================================================== //
+    // discard previous events and record the next ones, keeping the last
+    // capacity of them. The buffer is only reallocated when the capacity
+    // changes, but in any case start must not run while other threads may
+    // record events, e.g. call it outside parallel regions.
+    void start(size_t capacity = 1 << 16) {
+        if (capacity == 0)
+            throw std::invalid_argument("trace capacity must be positive");
+        _enabled = false;
+        if (_events.size() != capacity)
+            _events.assign(capacity, TraceEvent{});
+        _next    = 0;
+        _enabled = true;
+    }
+
+    // stop recording, keeping the events
+    inline void stop() {
+        _enabled = false;
+    }
+
+    inline bool enabled() const {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+    // ===================================================================== //
+    // record an event, overwriting the oldest one if the buffer is full
+    inline void record(const char* name, const char* category, double begin, double end) {
+        if (!enabled())
+            return;
+        const size_t n = _next++;
+        _events[n % _events.size()] = {name, category, begin, end,
+                                       std::hash<std::thread::id>()(std::this_thread::get_id())};
+    }
+
+    // ===================================================================== //
+    // events in the buffer, oldest first
+    std::vector<TraceEvent> events() const {
+        const size_t n     = _next;
+        const size_t first = n > _events.size() ? n - _events.size() : 0;
+        std::vector<TraceEvent> out;
+        for (size_t i = first; i != n; i++)
+            out.push_back(_events[i % _events.size()]);
+        return out;
+    }
+
+    // number of events dropped because the buffer was full
+    inline size_t dropped() const {
+        return _next > _events.size() ? _next - _events.size() : 0;
+    }
+};
+
+// ===================================================================== //
+// TraceRegion: event spanning the lifetime of the object, e.g.
+//     { TraceRegion region("smoother"); ... }
+class TraceRegion {
+private:
+    const char*     _name;
+    const char* _category;
+    double         _begin; // negative if tracing was off at construction
+
+public:
+    explicit TraceRegion(const char* name, const char* category = "user")
+        : _name     (name)
+        , _category (category)
+        , _begin    (Tracer::instance().enabled() ? MPI_Wtime() : -1) {}
+
+    ~TraceRegion() {
+        if (_begin >= 0)
+            Tracer::instance().record(_name, _category, _begin, MPI_Wtime());
+    }
+
+    TraceRegion(const TraceRegion&) = delete;
+    TraceRegion& operator = (const TraceRegion&) = delete;
+};
+
+// ===================================================================== //
+// start and stop tracing on this rank, see Tracer
+inline void start_tracing(size_t capacity = 1 << 16) {
+    Tracer::instance().start(capacity);
+}
+
+inline void stop_tracing() {
+    Tracer::instance().stop();
+}
+
+// ===================================================================== //
+// offset to add to MPI_Wtime on this rank to get the time of the first rank
+// of comm, estimated from the ping-pong with the smallest round trip time,
+// as in Cristian's algorithm. All ranks of comm must call this.
+inline double clock_offset(MPI_Comm comm, int nrounds = 10) {
+    int rank, nprocs;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nprocs);
+
+    double offset = 0;
+    for (int p = 1; p != nprocs; p++) {
+        if (rank == 0) {
+            double best = 1e30;
+            for (int n = 0; n != nrounds; n++) {
+                double remote;
+                const double t0 = MPI_Wtime();
+                MPI_Send(&t0, 1, MPI_DOUBLE, p, 0, comm);
+                MPI_Recv(&remote, 1, MPI_DOUBLE, p, 0, comm, MPI_STATUS_IGNORE);
+                const double t1 = MPI_Wtime();
+                if (t1 - t0 < best) {
+                    best   = t1 - t0;
+                    offset = 0.5*(t0 + t1) - remote;
+                }
+            }
+            MPI_Send(&offset, 1, MPI_DOUBLE, p, 1, comm);
+            offset = 0;
+        } else if (rank == p) {
+            for (int n = 0; n != nrounds; n++) {
+                double t0;
+                MPI_Recv(&t0, 1, MPI_DOUBLE, 0, 0, comm, MPI_STATUS_IGNORE);
+                const double now = MPI_Wtime();
+                MPI_Send(&now, 1, MPI_DOUBLE, 0, 0, comm);
+            }
+            MPI_Recv(&offset, 1, MPI_DOUBLE, 0, 1, comm, MPI_STATUS_IGNORE);
+        }
+    }
+    return offset;
+}
+
+// ===================================================================== //
+// JSON string literal of a name, escaping quotes, backslashes and control
+// characters
+inline std::string _json_string(const char* name) {
+    std::string out = "\"";
+    for (const char* c = name; *c != '\0'; c++) {
+        if (*c == '"' or *c == '\\') {
+            out += '\\';
+            out += *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned char>(*c));
+            out += escape;
+        } else {
+            out += *c;
+        }
+    }
+    return out + "\"";
+}
+
+// ===================================================================== //
+// write the events of all ranks of comm to a Chrome trace JSON file, one
+// process per rank and one thread per thread of the rank, with times in
+// microseconds from the first event of the run. All ranks of comm must
+// call this; the first one writes the file.
+inline void write_trace(const std::string& filename, MPI_Comm comm = MPI_COMM_WORLD) {
+    int rank, nprocs;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nprocs);
+
+    const Tracer& tracer = Tracer::instance();
+    const auto    events = tracer.events();
+    const double  offset = clock_offset(comm);
+
+    // origin of the timeline
+    double origin = 1e300;
+    for (const auto& event : events)
+        origin = std::min(origin, event.begin + offset);
+    MPI_Allreduce(MPI_IN_PLACE, &origin, 1, MPI_DOUBLE, MPI_MIN, comm);
+
+    std::string text;
+    char line[512];
+    std::snprintf(line, sizeof(line),
+                  "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+                  "\"args\": {\"name\": \"rank %d\"}},\n"
+                  "{\"name\": \"process_sort_index\", \"ph\": \"M\", \"pid\": %d, "
+                  "\"args\": {\"sort_index\": %d}},\n", rank, rank, rank, rank);
+    text += line;
+    if (tracer.dropped() > 0) {
+        std::snprintf(line, sizeof(line),
+                      "{\"name\": \"events dropped\", \"ph\": \"i\", \"s\": \"p\", \"pid\": %d, "
+                      "\"tid\": 0, \"ts\": 0, \"args\": {\"count\": %zu}},\n", rank, tracer.dropped());
+        text += line;
+    }
+    for (const auto& event : events) {
+        // names may be of any length, only the numbers go through line
+        text += "{\"name\": " + _json_string(event.name)
+              + ", \"cat\": " + _json_string(event.category);
+        std::snprintf(line, sizeof(line),
+                      ", \"ph\": \"X\", \"pid\": %d, \"tid\": %zu, \"ts\": %.3f, \"dur\": %.3f},\n",
+                      rank, event.tid % 1000000,
+                      1e6*(event.begin + offset - origin), 1e6*(event.end - event.begin));
+        text += line;
+    }
+
+    int length = text.size();
+    std::vector<int> lengths(nprocs), displs(nprocs);
+    MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, comm);
+    for (int p = 1; p < nprocs; p++)
+        displs[p] = displs[p-1] + lengths[p-1];
+    std::string all(rank == 0 ? displs.back() + lengths.back() : 0, ' ');
+    MPI_Gatherv(text.data(), length, MPI_CHAR,
+                &all[0], lengths.data(), displs.data(), MPI_CHAR, 0, comm);
+
+    int ok = 1;
+    if (rank == 0) {
+        FILE* file = std::fopen(filename.c_str(), "w");
+        if (file != nullptr) {
+            // the last event is followed by a comma
+            all.resize(all.size() - 2);
+            std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n%s\n]}\n",
+                         all.c_str());
+            std::fclose(file);
+        }
+        ok = file != nullptr;
+    }
+    MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+    if (!ok)
+        throw std::runtime_error("cannot open file " + filename);
+}
+
+}
@@ -0,0 +1,378 @@
+#pragma once
+#include <stdexcept>
+#include <vector>
+#include <deque>
+
+namespace DArrays {
+
+////////////////////////////////////////////////////////////////
+// Global transpose between slab decompositions, i.e. layouts //
+// whose processor grid is split along a single dimension.    //
+// Each rank sends to every other rank the part of its slab   //
+// that the other owns after the transpose, through one       //
+// MPI_Alltoallw with subarray types that skip the halo, so   //
+// that no explicit packing is needed.                        //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// dimension along which the processor grid of a slab layout is split.
+// With a single rank, this is dimension 0.
+template <size_t NDIMS>
+inline size_t slab_axis(const DArrayLayout<NDIMS>& layout) {
+    for (auto dim : LinRange(NDIMS))
+        if (layout.size(dim) == layout.nprocs())
+            return dim;
+    throw std::invalid_argument("layout is not a slab decomposition");
+}
+
+// ===================================================================== //
+// SlabTranspose: plan to copy the in-domain points of an array decomposed
+// along one dimension into an array with the same global size decomposed
+// along another. The two layouts must be built on the same communicator.
+// Types are created once, so that the transpose can be repeated cheaply.
+template <typename T, size_t NDIMS>
+class SlabTranspose {
+private:
+    std::deque<SubArray<T, NDIMS>>   _boxes; // blocks sent to and received from each rank
+    std::vector<MPI_Datatype>    _sendtypes;
+    std::vector<MPI_Datatype>    _recvtypes;
+    std::vector<int>                _counts; // one of each type
+    std::vector<int>                _displs; // all types start at the buffer
+    T*                                _send; // buffer of the input array
+    T*                                _recv; // buffer of the output array
+    MPI_Comm                          _comm; // duplicate of the layout communicator
+    std::vector<MPI_Request>      _requests; // of the non-blocking transpose
+
+public:
+    // ===================================================================== //
+    // constructor from the output and input arrays
+    SlabTranspose(DArray<T, NDIMS>& out, const DArray<T, NDIMS>& in)
+        : _send    (in.data())
+        , _recv    (out.data())
+        , _comm    (MPI_COMM_NULL) {
+            if (&out == &in)
+                throw std::invalid_argument("transpose cannot be done in place");
+
+            int result;
+            MPI_Comm_compare(in.layout().communicator(), out.layout().communicator(), &result);
+            if (result != MPI_IDENT and result != MPI_CONGRUENT)
+                throw std::invalid_argument("layouts must be built on the same communicator");
+
+            const size_t ax_in  = slab_axis(in.layout());
+            const size_t ax_out = slab_axis(out.layout());
+            if (ax_in == ax_out and in.layout().nprocs() > 1)
+                throw std::invalid_argument("layouts must be split along different dimensions");
+            for (auto dim : LinRange(NDIMS))
+                if (in.size(dim)*in.layout().size(dim) != out.size(dim)*out.layout().size(dim))
+                    throw std::invalid_argument("arrays must have the same global size");
+
+            // rank p owns the p-th slab along the decomposed dimension in both
+            // layouts: send the p-th block of the output slabs in my input
+            // slab, and receive the p-th block of the input slabs in my output
+            const int nprocs = in.layout().nprocs();
+            for (auto p : LinRange(nprocs)) {
+                std::array<int, NDIMS> origin = {};
+                std::array<int, NDIMS> size   = in.size();
+                origin[ax_out] = p*out.size(ax_out);
+                size[ax_out]   = out.size(ax_out);
+                _boxes.emplace_back(in, origin, size);
+                _sendtypes.push_back(_boxes.back().type());
+            }
+            for (auto p : LinRange(nprocs)) {
+                std::array<int, NDIMS> origin = {};
+                std::array<int, NDIMS> size   = out.size();
+                origin[ax_in] = p*in.size(ax_in);
+                size[ax_in]   = in.size(ax_in);
+                _boxes.emplace_back(out, origin, size);
+                _recvtypes.push_back(_boxes.back().type());
+            }
+            _counts.assign(nprocs, 1);
+            _displs.assign(nprocs, 0);
+
+            // messages of the plan must not match those of halo swaps on the
+            // layout communicator, e.g. while a transpose is in progress
+            MPI_Comm_dup(in.layout().communicator(), &_comm);
+    }
+
+    // ===================================================================== //
+    // a transpose in progress must complete before the buffers go away
+    ~SlabTranspose() {
+        wait();
+        MPI_Comm_free(&_comm);
+    }
+
+    SlabTranspose(const SlabTranspose&) = delete;
+    SlabTranspose& operator = (const SlabTranspose&) = delete;
+
+    // ===================================================================== //
+    // blocking transpose
+    void execute() {
+        MPI_Alltoallw(_send, _counts.data(), _displs.data(), _sendtypes.data(),
+                      _recv, _counts.data(), _displs.data(), _recvtypes.data(), _comm);
+    }
+
+    // ===================================================================== //
+    // non-blocking transpose: neither array can be used until wait() returns.
+    // This posts the same messages as MPI_Alltoallw point to point, since
+    // MPI_Ialltoallw with derived types is unreliable in some MPI releases.
+    void start() {
+        const int nprocs = _counts.size();
+        _requests.resize(2*nprocs);
+        for (auto p : LinRange(nprocs))
+            MPI_Irecv(_recv, 1, _recvtypes[p], p, 0, _comm, &_requests[p]);
+        for (auto p : LinRange(nprocs))
+            MPI_Isend(_send, 1, _sendtypes[p], p, 0, _comm, &_requests[nprocs + p]);
+    }
+
+    bool test() {
+        int flag;
+        MPI_Testall(_requests.size(), _requests.data(), &flag, MPI_STATUSES_IGNORE);
+        return flag;
+    }
+
+    void wait() {
+        MPI_Waitall(_requests.size(), _requests.data(), MPI_STATUSES_IGNORE);
+    }
+};
+
+// ===================================================================== //
+// one-off transpose of in into out, see SlabTranspose
+template <typename T, size_t NDIMS>
+void transpose(DArray<T, NDIMS>& out, const DArray<T, NDIMS>& in) {
+    SlabTranspose<T, NDIMS>(out, in).execute();
+}
+
+////////////////////////////////////////////////////////////////
+// Transposes between pencil decompositions, where the        //
+// processor grid is split along all dimensions but one. A    //
+// transpose makes another dimension local, and only involves //
+// the ranks along one direction of the grid, which exchange  //
+// data on a communicator obtained with MPI_Cart_sub. The     //
+// data is sent in chunks of packed buffers: a chunk is       //
+// packed while the previous ones are in flight.              //
+////////////////////////////////////////////////////////////////
+
+// ===================================================================== //
+// dimension that is not split in a pencil layout, i.e. the last one with
+// a processor grid of size one
+template <size_t NDIMS>
+inline size_t pencil_axis(const DArrayLayout<NDIMS>& layout) {
+    for (auto dim = NDIMS; dim-- > 0; )
+        if (layout.size(dim) == 1)
+            return dim;
+    throw std::invalid_argument("layout is not a pencil decomposition");
+}
+
+// ===================================================================== //
+// copy the rows of a box of local indices of a DArray from/to a buffer,
+// in memory order, returning the end of the data in the buffer
+template <typename T, size_t NDIMS>
+inline T* _pack_box(const DArray<T, NDIMS>& a, std::array<int, NDIMS> origin,
+                    std::array<int, NDIMS> size, T* buffer) {
+    const int length = size[0];
+    size[0] = 1;
+    for (const auto& index : IndexRange<NDIMS>(origin, size)) {
+        const T* row = a.cursor(index).ptr();
+        std::copy(row, row + length, buffer);
+        buffer += length;
+    }
+    return buffer;
+}
+
+template <typename T, size_t NDIMS>
+inline const T* _unpack_box(DArray<T, NDIMS>& a, std::array<int, NDIMS> origin,
+                            std::array<int, NDIMS> size, const T* buffer) {
+    const int length = size[0];
+    size[0] = 1;
+    for (const auto& index : IndexRange<NDIMS>(origin, size)) {
+        std::copy(buffer, buffer + length, a.cursor(index).ptr());
+        buffer += length;
+    }
+    return buffer;
+}
+
+// ===================================================================== //
+// PencilTranspose: plan to copy the in-domain points of an array in one
+// pencil layout into an array with the same global size in another. The
+// local dimension of the input, din, must be split in the output over the
+// direction of the processor grid along which the input splits the local
+// dimension of the output, dout; all other directions must agree, as for
+// X = {1, P, Q}, Y = {P, 1, Q} and Z = {P, Q, 1} pencils with X <-> Y and
+// Y <-> Z transposes. Layouts must be built on the same communicator.
+template <typename T, size_t NDIMS>
+class PencilTranspose {
+private:
+    DArray<T, NDIMS>&                   _out;
+    const DArray<T, NDIMS>&              _in;
+    size_t                              _din; // local dimension of the input
+    size_t                             _dout; // local dimension of the output
+    size_t                            _dpipe; // dimension split in chunks
+    int                             _nchunks;
+    MPI_Comm                           _comm; // ranks along dout in the input grid
+    int                              _nprocs;
+    std::array<std::vector<T>, 2>      _send; // packed chunks, double buffered
+    std::array<std::vector<T>, 2>      _recv;
+
+    // ===================================================================== //
+    // range of indices along the pipelined dimension in a chunk
+    inline int _chunk_origin(int chunk) const {
+        return static_cast<long>(_in.size(_dpipe))*chunk/_nchunks;
+    }
+
+    inline int _chunk_size(int chunk) const {
+        return _chunk_origin(chunk + 1) - _chunk_origin(chunk);
+    }
+
+    // ===================================================================== //
+    // block of a chunk going to/coming from rank q of the sub-communicator
+    void _pack(int chunk, int q, T* buffer) const {
+        std::array<int, NDIMS> origin = {};
+        std::array<int, NDIMS> size   = _in.size();
+        origin[_din]   = q*_out.size(_din);
+        size[_din]     = _out.size(_din);
+        origin[_dpipe] = _chunk_origin(chunk);
+        size[_dpipe]   = _chunk_size(chunk);
+        _pack_box(_in, origin, size, buffer);
+    }
+
+    void _unpack(int chunk, int q, const T* buffer) {
+        std::array<int, NDIMS> origin = {};
+        std::array<int, NDIMS> size   = _out.size();
+        origin[_dout]  = q*_in.size(_dout);
+        size[_dout]    = _in.size(_dout);
+        origin[_dpipe] = _chunk_origin(chunk);
+        size[_dpipe]   = _chunk_size(chunk);
+        _unpack_box(_out, origin, size, buffer);
+    }
+
+    // product of the local sizes along the dimensions that do not take part
+    inline int _other_size() const {
+        int n = 1;
+        for (size_t dim = 0; dim != NDIMS; dim++)
+            if (dim != _din and dim != _dout and dim != _dpipe)
+                n *= _in.size(dim);
+        return n;
+    }
+
+public:
+    // ===================================================================== //
+    // constructor from the output and input arrays, and the number of
+    // chunks the data is sent in, at most the local size of the input
+    // along the pipelined dimension
+    PencilTranspose(DArray<T, NDIMS>& out, const DArray<T, NDIMS>& in, int nchunks = 4)
+        : _out  (out)
+        , _in   (in )
+        , _comm (MPI_COMM_NULL) {
+            static_assert(NDIMS >= 3, "pencil decompositions require at least three dimensions");
+            if (&out == &in)
+                throw std::invalid_argument("transpose cannot be done in place");
+            if (nchunks < 1)
+                throw std::invalid_argument("number of chunks must be positive");
+
+            int result;
+            MPI_Comm_compare(in.layout().communicator(), out.layout().communicator(), &result);
+            if (result != MPI_IDENT and result != MPI_CONGRUENT)
+                throw std::invalid_argument("layouts must be built on the same communicator");
+
+            for (auto dim : LinRange(NDIMS))
+                if (in.size(dim)*in.layout().size(dim) != out.size(dim)*out.layout().size(dim))
+                    throw std::invalid_argument("arrays must have the same global size");
+
+            _din  = pencil_axis(in.layout());
+            _dout = pencil_axis(out.layout());
+
+            // the grids must be the same, but for the direction moving from
+            // dout to din. Since all ranks see the same grids, all throw.
+            bool compatible = _din != _dout and
+                in.layout().size(_din)  == 1 and out.layout().size(_dout) == 1 and
+                out.layout().size(_din) == in.layout().size(_dout);
+            for (size_t dim = 0; dim != NDIMS; dim++)
+                if (dim != _din and dim != _dout)
+                    compatible = compatible and in.layout().size(dim) == out.layout().size(dim);
+
+            // and each rank must own the same range along the directions that
+            // are not exchanged, with its position along dout in the input
+            // grid that along din in the output, e.g. not for X <-> Z on a
+            // square grid. This differs across ranks, who agree on it.
+            int matching = compatible and
+                in.layout().coords(_dout) == out.layout().coords(_din);
+            for (size_t dim = 0; dim != NDIMS; dim++)
+                if (dim != _din and dim != _dout)
+                    matching = matching and in.layout().coords(dim) == out.layout().coords(dim);
+            MPI_Allreduce(MPI_IN_PLACE, &matching, 1, MPI_INT, MPI_LAND,
+                          in.layout().communicator());
+            if (!matching)
+                throw std::invalid_argument("incompatible pencil layouts");
+
+            // pipeline along the slowest varying of the other dimensions
+            for (size_t dim = 0; dim != NDIMS; dim++)
+                if (dim != _din and dim != _dout)
+                    _dpipe = dim;
+            _nchunks = std::min(nchunks, in.size(_dpipe));
+
+            std::array<int, NDIMS> remain = {};
+            remain[_dout] = 1;
+            MPI_Cart_sub(in.layout().communicator(), remain.data(), &_comm);
+            MPI_Comm_size(_comm, &_nprocs);
+
+            // the largest chunk has ceil(n/nchunks) points along dpipe
+            const int    lmax = (in.size(_dpipe) + _nchunks - 1)/_nchunks;
+            const size_t nmax = static_cast<size_t>(_nprocs)*_out.size(_din)*_in.size(_dout)
+                                *lmax*_other_size();
+            for (auto& buffer : _send) buffer.resize(nmax);
+            for (auto& buffer : _recv) buffer.resize(nmax);
+    }
+
+    ~PencilTranspose() {
+        if (_comm != MPI_COMM_NULL)
+            MPI_Comm_free(&_comm);
+    }
+
+    PencilTranspose(const PencilTranspose&) = delete;
+    PencilTranspose& operator = (const PencilTranspose&) = delete;
+
+    // ===================================================================== //
+    // transpose, chunk by chunk: each chunk is packed and its all-to-all
+    // started before the previous chunk is waited for and unpacked. The
+    // pending exchange is progressed between the blocks being packed.
+    void execute() {
+        TraceRegion region("PencilTranspose", "transpose");
+        std::array<MPI_Request, 2> requests = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+
+        for (auto chunk : LinRange(_nchunks + 1)) {
+            const int slot = chunk % 2;
+            if (chunk < _nchunks) {
+                TraceRegion pack("pack", "transpose");
+                const int count = _out.size(_din)*_in.size(_dout)*_chunk_size(chunk)*_other_size();
+                for (auto q : LinRange(_nprocs)) {
+                    _pack(chunk, q, _send[slot].data() + static_cast<size_t>(q)*count);
+                    int flag;
+                    MPI_Test(&requests[1 - slot], &flag, MPI_STATUS_IGNORE);
+                }
+                MPI_Ialltoall(_send[slot].data(), count, MPI::mpi_type<T>(),
+                              _recv[slot].data(), count, MPI::mpi_type<T>(),
+                              _comm, &requests[slot]);
+            }
+            if (chunk > 0) {
+                const int prev  = chunk - 1;
+                const int count = _out.size(_din)*_in.size(_dout)*_chunk_size(prev)*_other_size();
+                {
+                    TraceRegion wait("wait", "transpose");
+                    MPI_Wait(&requests[1 - slot], MPI_STATUS_IGNORE);
+                }
+                TraceRegion unpack("unpack", "transpose");
+                for (auto q : LinRange(_nprocs))
+                    _unpack(prev, q, _recv[1 - slot].data() + static_cast<size_t>(q)*count);
+            }
+        }
+    }
+};
+
+// ===================================================================== //
+// one-off pencil transpose of in into out, see PencilTranspose
+template <typename T, size_t NDIMS>
+void pencil_transpose(DArray<T, NDIMS>& out, const DArray<T, NDIMS>& in, int nchunks = 4) {
+    PencilTranspose<T, NDIMS>(out, in, nchunks).execute();
+}
+
+}
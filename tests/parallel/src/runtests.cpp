@@ -4,7 +4,7 @@
 
 
 int main(int argc, char* argv[]) {
-    DArrays::MPI::Initialize();
+    DArrays::MPI::Initialize(MPI_THREAD_MULTIPLE);
     const int result = Catch::Session().run(argc, argv);
     DArrays::MPI::Finalize();
     return result;
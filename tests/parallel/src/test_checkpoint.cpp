@@ -0,0 +1,176 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("checkpoint - asynchronous", "test_1") {
+
+    std::array<int, 3> is_periodic = {false, false, false};
+    DArrayLayout<3> layout(MPI_COMM_WORLD, {3, 3, 3}, is_periodic);
+
+    std::array<int, 3> array_size = {6, 9, 12};
+    DArray<double, 3> u(layout, array_size, {1, 1, 1}, {1, 1, 1});
+    DArray<double, 3> v(layout, array_size, {1, 1, 1}, {1, 1, 1});
+
+    // value from the global index and the step
+    auto f = [](int i, int j, int k, int step) { return i + 100*j + 10000*k + 1000000*step; };
+    auto fill = [&](int step) {
+        for (auto [i, j, k] : u.indices()) {
+            auto [gi, gj, gk] = u.global_index({i, j, k});
+            u(i, j, k) =  f(gi, gj, gk, step);
+            v(i, j, k) = -f(gi, gj, gk, step);
+        }
+    };
+
+    const int rank = layout.rank();
+    auto name = [](int step) { return "test_checkpoint_" + std::to_string(step) + ".darray"; };
+
+    SECTION("snapshots are taken when saving") {
+        std::vector<CheckpointFuture> handles;
+        {
+            AsyncCheckpoint<double, 3> checkpoint({&u, &v});
+
+            // more checkpoints than staging buffers, modifying the arrays as
+            // soon as each is started
+            for (int step = 0; step != 4; step++) {
+                fill(step);
+                handles.push_back(checkpoint.save(name(step)));
+                fill(-1);
+            }
+            handles.front().wait();
+            REQUIRE( handles.front().test() );
+            checkpoint.wait();
+        }
+
+        for (int step = 0; step != 4; step++) {
+            REQUIRE( handles[step].test() );
+
+            // two records, one per array
+            auto headers = read_headers(name(step), MPI_COMM_WORLD);
+            REQUIRE( headers.size() == 2 );
+            REQUIRE( headers[1].second == headers[0].first.record_size() );
+            for (const auto& record : headers) {
+                REQUIRE( std::string(record.first.magic) == "DARRAYS" );
+                REQUIRE_NOTHROW( record.first.check(v) );
+            }
+
+            // the first is read as a single array file
+            DArray<double, 3> w(layout, array_size, {1, 1, 1}, {1, 1, 1});
+            w.read(name(step));
+            for (auto [i, j, k] : w.indices()) {
+                auto [gi, gj, gk] = w.global_index({i, j, k});
+                REQUIRE( w(i, j, k) == f(gi, gj, gk, step) );
+            }
+
+            // the second one from the file content
+            if (rank == 0) {
+                std::ifstream file(name(step), std::ios::binary);
+                for (auto [gi, gj, gk] : {std::array<int, 3>{0, 0, 0},
+                                          std::array<int, 3>{5, 8, 11}}) {
+                    double value;
+                    file.seekg(headers[1].second + FileHeader::data_offset
+                               + sizeof(double)*(gi + 6*(gj + 9*gk)));
+                    file.read(reinterpret_cast<char*>(&value), sizeof(double));
+                    REQUIRE( value == -f(gi, gj, gk, step) );
+                }
+            }
+        }
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        if (rank == 0)
+            for (int step = 0; step != 4; step++)
+                std::remove(name(step).c_str());
+    }
+
+    SECTION("errors are reported by the handle") {
+        AsyncCheckpoint<double, 3> checkpoint({&u});
+        auto handle = checkpoint.save("no_such_directory/test_checkpoint.darray");
+        REQUIRE_THROWS_AS( handle.wait(), std::runtime_error );
+    }
+
+    SECTION("invalid arguments") {
+        REQUIRE_THROWS( AsyncCheckpoint<double, 3>({}) );
+    }
+}
+
+TEST_CASE("checkpoint - restart on a different layout", "test_2") {
+
+    std::array<int, 3> is_periodic = {false, false, false};
+    DArrayLayout<3> layout(MPI_COMM_WORLD, {3, 3, 3}, is_periodic);
+
+    // divisible by all the grids below
+    std::array<int, 3> array_size = {54, 18, 36};
+    DArray<double, 3> u(layout, array_size, {1, 1, 1}, {1, 1, 1});
+    DArray<double, 3> v(layout, array_size, {1, 1, 1}, {1, 1, 1});
+
+    auto f = [](int i, int j, int k) { return i + 100*j + 10000*k; };
+    for (auto [i, j, k] : u.indices()) {
+        auto [gi, gj, gk] = u.global_index({i, j, k});
+        u(i, j, k) =  f(gi, gj, gk);
+        v(i, j, k) = -f(gi, gj, gk);
+    }
+
+    const std::string filename = "test_restart.darray";
+    {
+        AsyncCheckpoint<double, 3> checkpoint({&u, &v});
+        checkpoint.save(filename).wait();
+    }
+
+    // the size of the arrays to restart from the header
+    const auto size = read_header(filename, MPI_COMM_WORLD).array_size<3>();
+    REQUIRE( size == array_size );
+
+    auto check = [&](DArray<double, 3>& a, double sign) {
+        for (auto [i, j, k] : a.indices()) {
+            auto [gi, gj, gk] = a.global_index({i, j, k});
+            REQUIRE( a(i, j, k) == sign*f(gi, gj, gk) );
+        }
+    };
+
+    SECTION("same ranks, other grids") {
+        for (auto grid : {std::array<int, 3>{27, 1, 1}, std::array<int, 3>{1, 3, 9}}) {
+            DArrayLayout<3> other(MPI_COMM_WORLD, grid, is_periodic);
+            DArray<double, 3> a(other, size, {1, 1, 1}, {1, 1, 1});
+            DArray<double, 3> b(other, size, {1, 1, 1}, {1, 1, 1});
+            restart(filename, std::vector<DArray<double, 3>*>{&a, &b});
+            check(a,  1);
+            check(b, -1);
+        }
+    }
+
+    SECTION("fewer ranks") {
+        MPI_Comm comm;
+        const bool member = layout.rank() < 8;
+        MPI_Comm_split(MPI_COMM_WORLD, member ? 0 : MPI_UNDEFINED, layout.rank(), &comm);
+        if (member) {
+            DArrayLayout<3> other(comm, {2, 2, 2}, is_periodic);
+            DArray<double, 3> a(other, size, {1, 1, 1}, {1, 1, 1});
+            DArray<double, 3> b(other, size, {2, 2, 2}, {1, 1, 1});
+            restart(filename, std::vector<DArray<double, 3>*>{&a, &b});
+            check(a,  1);
+            check(b, -1);
+            MPI_Comm_free(&comm);
+        }
+    }
+
+    SECTION("invalid arguments") {
+        DArray<double, 3> a(layout, size, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS_AS( restart(filename, std::vector<DArray<double, 3>*>{&a}),
+                           std::invalid_argument );
+
+        DArray<double, 3> b(layout, {54, 18, 18}, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS_AS( restart(filename, std::vector<DArray<double, 3>*>{&a, &b}),
+                           std::invalid_argument );
+        REQUIRE_THROWS_AS( read_header(filename, MPI_COMM_WORLD).array_size<2>(),
+                           std::invalid_argument );
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (layout.rank() == 0)
+        std::remove(filename.c_str());
+}
@@ -0,0 +1,144 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("compress - chunked compressed output", "test_1") {
+
+    DArrayLayout<3> layout(MPI_COMM_WORLD, {3, 3, 3}, {false, true, false});
+
+    std::array<int, 3> array_size = {24, 36, 54};
+    DArray<double, 3> a(layout, array_size, {1, 1, 1}, {1, 1, 1});
+
+    // smooth value from the global index
+    auto f = [](int i, int j, int k) { return std::sin(0.1*i) + std::cos(0.2*j) + 0.01*k; };
+
+    for (auto [i, j, k] : a.indices()) {
+        auto [gi, gj, gk] = a.global_index({i, j, k});
+        a(i, j, k) = f(gi, gj, gk);
+    }
+
+    // uneven chunks of the local blocks of size {8, 12, 18}
+    const std::array<int, 3> chunk = {8, 5, 18};
+    const std::string filename = "test_compress.darray";
+    const long raw_size = FileHeader::data_offset + 24*36*54*long(sizeof(double));
+
+    // compressed file size, from the first rank
+    auto file_size = [&]() {
+        long size = 0;
+        if (layout.rank() == 0)
+            size = std::ifstream(filename, std::ios::binary | std::ios::ate).tellg();
+        MPI_Bcast(&size, 1, MPI_LONG, 0, MPI_COMM_WORLD);
+        return size;
+    };
+
+    SECTION("lossless") {
+        ThreadPool pool(2);
+        write_compressed(a, filename, chunk, Codec::SHUFFLE, 0, &pool);
+        REQUIRE( 1.1*file_size() < raw_size );
+
+        DArray<double, 3> b(layout, array_size, {1, 1, 1}, {1, 1, 1});
+        read_compressed(b, filename);
+        for (auto [i, j, k] : b.indices())
+            REQUIRE( b(i, j, k) == a(i, j, k) );
+
+        FileHeader header = read_header(filename, MPI_COMM_WORLD);
+        REQUIRE( std::string(header.magic) == "DARRAYZ" );
+    }
+
+    SECTION("lossy") {
+        const double tolerance = 1e-4;
+        write_compressed(a, filename, chunk, Codec::QUANTIZE, tolerance);
+        REQUIRE( 10*file_size() < raw_size );
+
+        DArray<double, 3> b(layout, array_size, {1, 1, 1}, {1, 1, 1});
+        read_compressed(b, filename);
+        for (auto [i, j, k] : b.indices())
+            REQUIRE( std::abs(b(i, j, k) - a(i, j, k)) <= tolerance*(1 + 1e-12) );
+    }
+
+    SECTION("read on a different layout and by box") {
+        write_compressed(a, filename, chunk);
+
+        DArrayLayout<3> other(MPI_COMM_WORLD, {1, 3, 9}, {false, true, false});
+        DArray<double, 3> b(other, array_size, {1, 1, 1}, {1, 1, 1});
+        read_compressed(b, filename);
+        for (auto [i, j, k] : b.indices()) {
+            auto [gi, gj, gk] = b.global_index({i, j, k});
+            REQUIRE( b(i, j, k) == f(gi, gj, gk) );
+        }
+
+        // a box across the chunks of several ranks, read by one rank only
+        if (layout.rank() == 0) {
+            const std::array<int, 3> origin = {2, 5, 7}, size = {7, 3, 11};
+            auto values = read_compressed_box<double, 3>(filename, origin, size);
+            REQUIRE( values.size() == 7*3*11 );
+            for (auto [i, j, k] : IndexRange<3>(size))
+                REQUIRE( values[i + 7*(j + 3*k)] == f(origin[0] + i, origin[1] + j, origin[2] + k) );
+
+            REQUIRE_THROWS_AS( (read_compressed_box<double, 3>(filename, origin, {7, 3, 50})),
+                               std::out_of_range );
+            REQUIRE_THROWS_AS( (read_compressed_box<float, 3>(filename, origin, size)),
+                               std::invalid_argument );
+        }
+    }
+
+    SECTION("invalid arguments") {
+        REQUIRE_THROWS_AS( write_compressed(a, filename, chunk, Codec::QUANTIZE, 0),
+                           std::invalid_argument );
+
+        DArray<int, 3> c(layout, array_size, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS_AS( write_compressed(c, filename, chunk, Codec::QUANTIZE, 1.0),
+                           std::invalid_argument );
+
+        // plain files are not compressed files
+        a.write(filename);
+        DArray<double, 3> b(layout, array_size, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS_AS( read_compressed(b, filename), std::invalid_argument );
+
+        // nor are compressed files cut short in their index
+        write_compressed(a, filename, chunk);
+        if (layout.rank() == 0) {
+            std::vector<char> bytes(FileHeader::data_offset + 100);
+            std::ifstream(filename, std::ios::binary).read(bytes.data(), bytes.size());
+            std::ofstream(filename, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        REQUIRE_THROWS_AS( read_compressed(b, filename), std::runtime_error );
+
+        // or in their chunk data
+        write_compressed(a, filename, chunk);
+        const long size = file_size();
+        if (layout.rank() == 0) {
+            std::vector<char> bytes(size - 100);
+            std::ifstream(filename, std::ios::binary).read(bytes.data(), bytes.size());
+            std::ofstream(filename, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        REQUIRE_THROWS_AS( read_compressed(b, filename), std::runtime_error );
+
+        // and corrupt chunks, read by some ranks only, make all ranks throw
+        write_compressed(a, filename, chunk);
+        if (layout.rank() == 0) {
+            std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(size - 64);
+            file.write(std::string(64, '\xff').data(), 64);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        REQUIRE_THROWS_AS( read_compressed(b, filename), std::runtime_error );
+        REQUIRE_THROWS_AS( (read_compressed_box<double, 3>(filename, {0, 0, 0}, array_size)),
+                           std::runtime_error );
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (layout.rank() == 0)
+        std::remove(filename.c_str());
+}
@@ -0,0 +1,78 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("cursor - rows and cursors", "test_1") {
+
+    // use this grid layout for tests
+    std::array<int, 3> layout_size = {3, 3, 3};
+    std::array<int, 3> is_periodic = {false, false, false};
+
+    // create layout
+    DArrayLayout<3> layout(MPI_COMM_WORLD, layout_size, is_periodic);
+
+    // create arrays
+    std::array<int, 3> array_size = {3*4, 3*5, 3*6};
+    std::array<int, 3> nhalo_out  = {1, 1, 1};
+    std::array<int, 3> nhalo_in   = {2, 2, 2};
+    DArray<double, 3> A(layout, array_size, nhalo_out, nhalo_in);
+    DArray<double, 3> B(layout, array_size, nhalo_out, nhalo_in);
+
+    for (int k = -1; k != 7; k++)
+        for (int j = -1; j != 6; j++)
+            for (int i = -1; i != 5; i++)
+                A(i, j, k) = i + 10*j + 100*k;
+
+    SECTION("rows cover the domain") {
+        int nrows = 0;
+        for (auto row : A.rows()) {
+            auto [i, j, k] = row.index();
+            REQUIRE( i == 0 );
+            REQUIRE( row.size() == 4 );
+            for (int n = 0; n != row.size(); n++)
+                REQUIRE( row[n] == A(n, j, k) );
+            REQUIRE( row.at<1>(-1)[2] == A(2, j-1, k) );
+            REQUIRE( row.at<2>(+1)[3] == A(3, j, k+1) );
+            nrows++;
+        }
+        REQUIRE( nrows == 5*6 );
+
+        // row of a given index, and span interface
+        std::array<int, 3> index = {3, 2, 1};
+        auto row = B.row(index);
+        std::fill(row.begin(), row.end(), 7);
+        for (int i = 0; i != 4; i++)
+            REQUIRE( B(i, 2, 1) == 7 );
+    }
+
+    SECTION("cursor neighbours and stepping") {
+        const auto& cA = A;
+        auto c = cA.cursor({1, 2, 3});
+        REQUIRE( *c == A(1, 2, 3) );
+        REQUIRE( c.at<0>(+1) == A(2, 2, 3) );
+        REQUIRE( c.at<1>(-1) == A(1, 1, 3) );
+        REQUIRE( c.at<2>(+1) == A(1, 2, 4) );
+        REQUIRE( c(-1, 1, -1) == A(0, 3, 2) );
+
+        ++c;
+        REQUIRE( *c == A(2, 2, 3) );
+        c.move<2>(-2);
+        REQUIRE( *c == A(2, 2, 1) );
+    }
+
+    SECTION("row-wise kernel") {
+        for (const auto& row : static_cast<const DArray<double, 3>&>(A).rows()) {
+            double* __restrict__ b = B.row(row.index()).data();
+            const double* n = row.at<1>(+1);
+            const double* s = row.at<1>(-1);
+            for (int i = 0; i != row.size(); i++)
+                b[i] = n[i] - s[i];
+        }
+        for (auto [i, j, k] : B.indices())
+            REQUIRE( B(i, j, k) == 20 );
+    }
+}
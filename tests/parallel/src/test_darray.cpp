@@ -200,4 +200,103 @@ TEST_CASE("darray - 2D", "test_2]") {
         // test nelements
         REQUIRE( a.nelements() == 13*14 );   
     }
-}
\ No newline at end of file
+}
+TEST_CASE("darray - red-black halo swap", "test_3") {
+
+    // use this grid layout for tests
+    std::array<int, 3> layout_size = {3, 3, 3};
+
+    // odd local sizes, so that the colour of the local origin changes
+    // across ranks, then even global sizes for the periodic case
+    for (auto [periodic, n] : {std::pair{false, 5}, std::pair{true, 4}}) {
+        std::array<int, 3> is_periodic = {periodic, periodic, periodic};
+        DArrayLayout<3> layout(MPI_COMM_WORLD, layout_size, is_periodic);
+
+        std::array<int, 3> array_size = {3*n, 3*n, 3*n};
+        std::array<int, 3> nhalo      = {1, 1, 1};
+        DArray<double, 3> a(layout, array_size, nhalo, nhalo);
+
+        // global index of local index i along dimension dim, or -1 if
+        // outside the domain
+        auto global = [&](int i, size_t dim) {
+            int g = layout.coords(dim)*n + i;
+            if (periodic)
+                return (g + 3*n) % (3*n);
+            return (g < 0 or g >= 3*n) ? -1 : g;
+        };
+
+        // points of each colour are visited once, with the right colour
+        for (auto colour : {Colour::RED, Colour::BLACK}) {
+            int count = 0;
+            for (auto [i, j, k] : a.indices(colour)) {
+                int sum = global(i, 0) + global(j, 1) + global(k, 2);
+                REQUIRE( (sum & 1) == static_cast<int>(colour) );
+                count++;
+            }
+            REQUIRE( (count == n*n*n/2 or count == n*n*n/2 + 1) );
+        }
+
+        // red points hold their global linear index, black points zero
+        std::fill(a.begin(), a.end(), -1);
+        for (auto [i, j, k] : a.indices())
+            a(i, j, k) = 0;
+        for (auto [i, j, k] : a.indices(Colour::RED))
+            a(i, j, k) = global(i, 0) + 100*global(j, 1) + 10000*global(k, 2);
+
+        a.swap_halo(Colour::RED);
+
+        // only red halo points, including the corners, have been received
+        for (int k = -1; k != n + 1; k++)
+            for (int j = -1; j != n + 1; j++)
+                for (int i = -1; i != n + 1; i++) {
+                    int gi = global(i, 0), gj = global(j, 1), gk = global(k, 2);
+                    bool inside = i >= 0 and i < n and j >= 0 and j < n and k >= 0 and k < n;
+                    bool red    = ((gi + gj + gk) & 1) == 0;
+                    if (gi == -1 or gj == -1 or gk == -1)
+                        REQUIRE( a(i, j, k) == -1 );
+                    else if (red)
+                        REQUIRE( a(i, j, k) == gi + 100*gj + 10000*gk );
+                    else
+                        REQUIRE( a(i, j, k) == (inside ? 0 : -1) );
+                }
+    }
+
+    // colours do not match across periodic boundaries with odd sizes
+    DArrayLayout<3> layout(MPI_COMM_WORLD, layout_size, {true, false, false});
+    DArray<double, 3> a(layout, {3*5, 3*4, 3*4}, {1, 1, 1}, {1, 1, 1});
+    REQUIRE_THROWS( a.swap_halo(Colour::BLACK) );
+}
+
+TEST_CASE("darray - global index mapping", "test_4]") {
+
+    // periodic along the first dimension only
+    DArrayLayout<3> layout(MPI_COMM_WORLD, {3, 9, 1}, {true, false, false});
+    DArray<double, 3> a(layout, {6, 18, 4}, {1, 1, 1}, {1, 1, 1});
+
+    const auto& coords = layout.coords();
+    REQUIRE( layout.rank_of(coords) == layout.rank() );
+    REQUIRE( layout.coords_of(layout.rank()) == coords );
+
+    REQUIRE( a.array_size() == std::array<int, 3>{6, 18, 4} );
+    REQUIRE( a.origin() == std::array<int, 3>{2*coords[0], 2*coords[1], 0} );
+
+    // round trip, including halo points
+    for (auto index : {std::array<int, 3>{0, 0, 0}, std::array<int, 3>{1, -1, 3}}) {
+        const auto global = a.global_index(index);
+        REQUIRE( global == std::array<int, 3>{2*coords[0] + index[0],
+                                              2*coords[1] + index[1], index[2]} );
+        REQUIRE( a.local_index(global) == index );
+    }
+
+    // owners of in-domain points
+    REQUIRE( a.is_local(a.origin()) );
+    REQUIRE( a.owner(a.origin()) == layout.rank() );
+    REQUIRE( a.owner({5, 17, 3}) == layout.rank_of({2, 8, 0}) );
+    REQUIRE_FALSE( a.is_local(a.global_index({2, 0, 0})) );
+
+    // wrap around the periodic dimension, throw along the others
+    REQUIRE( a.wrap_index({-1, 3, 1}) == std::array<int, 3>{5, 3, 1} );
+    REQUIRE( a.owner({6, 0, 0}) == layout.rank_of({0, 0, 0}) );
+    REQUIRE_THROWS_AS( a.owner({0, 18, 0}), std::out_of_range );
+    REQUIRE_THROWS_AS( a.owner({0, 0, -1}), std::out_of_range );
+}
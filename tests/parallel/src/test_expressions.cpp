@@ -0,0 +1,121 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("expressions - element-wise", "test_1") {
+
+    // use this grid layout for tests
+    std::array<int, 3> layout_size = {3, 3, 3};
+    std::array<int, 3> is_periodic = {false, false, false};
+
+    // create layout
+    DArrayLayout<3> layout(MPI_COMM_WORLD, layout_size, is_periodic);
+
+    // create arrays
+    std::array<int, 3> array_size = {3*4, 3*5, 3*6};
+    std::array<int, 3> nhalo_out  = {1, 1, 1};
+    std::array<int, 3> nhalo_in   = {1, 1, 1};
+    DArray<double, 3> A(layout, array_size, nhalo_out, nhalo_in);
+    DArray<double, 3> B(layout, array_size, nhalo_out, nhalo_in);
+    DArray<double, 3> C(layout, array_size, nhalo_out, nhalo_in);
+    DArray<double, 3> D(layout, array_size, nhalo_out, nhalo_in);
+
+    for (auto [i, j, k] : A.indices()) {
+        A(i, j, k) = i + j;
+        B(i, j, k) = j - k;
+        D(i, j, k) = 3*k;
+    }
+
+    SECTION("fused arithmetic") {
+        double a = 2.5;
+        C = a*A + B*B - D;
+        for (auto [i, j, k] : C.indices())
+            REQUIRE( C(i, j, k) == a*(i + j) + (j - k)*(j - k) - 3*k );
+
+        C = -A / 2 + 1;
+        for (auto [i, j, k] : C.indices())
+            REQUIRE( C(i, j, k) == -(i + j) / 2.0 + 1 );
+    }
+
+    SECTION("compound assignment") {
+        C = 1.0;
+        C += A;
+        C -= 2*B;
+        for (auto [i, j, k] : C.indices())
+            REQUIRE( C(i, j, k) == 1.0 + (i + j) - 2*(j - k) );
+    }
+
+    SECTION("assignment does not touch the halo") {
+        std::fill(C.begin(), C.end(), -1);
+        C = A;
+        REQUIRE( C(-1, 0, 0) == -1 );
+        REQUIRE( C( 0, 0, 0) == A(0, 0, 0) );
+        REQUIRE( C( 4, 5, 6) == -1 );
+    }
+
+    SECTION("incompatible sizes") {
+        std::array<int, 3> other_size = {3*5, 3*5, 3*6};
+        DArray<double, 3> E(layout, other_size, nhalo_out, nhalo_in);
+        REQUIRE_THROWS( A + E );
+        REQUIRE_THROWS( E = A );
+    }
+}
+
+TEST_CASE("expressions - shifted operands", "test_2") {
+
+    // use this grid layout for tests
+    std::array<int, 2> layout_size = {3, 9};
+    std::array<int, 2> is_periodic = {true, true};
+
+    // create layout
+    DArrayLayout<2> layout(MPI_COMM_WORLD, layout_size, is_periodic);
+
+    // create arrays
+    std::array<int, 2> array_size = {3*4, 9*5};
+    std::array<int, 2> nhalo_out  = {2, 1};
+    std::array<int, 2> nhalo_in   = {2, 1};
+    DArray<double, 2> A(layout, array_size, nhalo_out, nhalo_in);
+    DArray<double, 2> B(layout, array_size, nhalo_out, nhalo_in);
+
+    SECTION("centered difference in the interior") {
+        for (auto [i, j] : A.indices())
+            A(i, j) = i*i + 10*j;
+
+        B = A.shift<0>(+1) - A.shift<0>(-1);
+        for (int j = 0; j != 5; j++)
+            for (int i = 1; i != 3; i++)
+                REQUIRE( B(i, j) == 4*i );
+
+        B = A.shift<1>(+1) + A.shift<1>(-1) - 2*A;
+        for (int j = 1; j != 4; j++)
+            for (int i = 0; i != 4; i++)
+                REQUIRE( B(i, j) == 0 );
+    }
+
+    SECTION("shifted operands read the halo") {
+        std::fill(A.begin(), A.end(), layout.rank());
+        A.swap_halo();
+
+        B = A.shift<1>(+1);
+        for (int i = 0; i != 4; i++)
+            REQUIRE( B(i, 4) == layout.rank_of_neighbour_at(Boundary::RIGHT, 1) );
+
+        B = A.shift<0>(-2);
+        for (int j = 0; j != 5; j++)
+            REQUIRE( B(0, j) == layout.rank_of_neighbour_at(Boundary::LEFT, 0) );
+
+        B = A.shift<0>(+1).shift<1>(-1);
+        REQUIRE( B(3, 0) == layout.rank_of_neighbour_at(
+                            HaloRegionSpec<2>(Boundary::RIGHT, Boundary::LEFT)) );
+    }
+
+    SECTION("shift larger than halo") {
+        REQUIRE_THROWS( A.shift<0>(+3) );
+        REQUIRE_THROWS( A.shift<1>(-2) );
+        REQUIRE_THROWS( A.shift<1>(+1).shift<1>(+1) );
+    }
+}
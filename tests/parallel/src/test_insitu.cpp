@@ -0,0 +1,96 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("insitu - streaming of selected points", "test_1") {
+
+    DArrayLayout<3> layout(MPI_COMM_WORLD, {3, 3, 3}, {false, true, false});
+
+    std::array<int, 3> array_size = {12, 18, 27};
+    DArray<double, 3> a(layout, array_size, {1, 1, 1}, {1, 1, 1});
+
+    // value from the global index and the step
+    auto f = [](int i, int j, int k, int step) { return i + 100*j + 10000*k + 1000000*step; };
+    auto fill = [&](int step) {
+        for (auto [i, j, k] : a.indices()) {
+            auto [gi, gj, gk] = a.global_index({i, j, k});
+            a(i, j, k) = f(gi, gj, gk, step);
+        }
+    };
+
+    const std::string filename = "test_insitu.darray";
+
+    // stream three snapshots, modifying the array as soon as each is pushed,
+    // then check every point of each record against the selection
+    auto check = [&](const Selection<3>& selection, OutputMode mode, int nactive) {
+        {
+            InSituStream<double, 3> stream(a, selection, filename, mode);
+            REQUIRE( stream.shape() == selection.shape() );
+
+            int active = stream.is_active();
+            MPI_Allreduce(MPI_IN_PLACE, &active, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+            REQUIRE( active == nactive );
+
+            for (int step = 0; step != 3; step++) {
+                fill(step);
+                stream.push();
+                fill(-1);
+            }
+            stream.wait();
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        if (layout.rank() == 0) {
+            const auto shape = selection.shape();
+            auto headers = read_headers(filename, MPI_COMM_SELF);
+            REQUIRE( headers.size() == 3 );
+            REQUIRE( headers[0].first.array_size<3>() == shape );
+
+            std::ifstream file(filename, std::ios::binary);
+            for (int step = 0; step != 3; step++) {
+                std::vector<double> values(shape[0]*shape[1]*shape[2]);
+                file.seekg(headers[step].second + FileHeader::data_offset);
+                file.read(reinterpret_cast<char*>(values.data()), values.size()*sizeof(double));
+                for (auto [i, j, k] : IndexRange<3>(shape))
+                    REQUIRE( values[i + shape[0]*(j + shape[1]*k)] ==
+                             f(selection.origin[0] + i*selection.stride[0],
+                               selection.origin[1] + j*selection.stride[1],
+                               selection.origin[2] + k*selection.stride[2], step) );
+            }
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    };
+
+    SECTION("plane") {
+        // on the ranks owning k = 13 only
+        check(plane(array_size, 2, 13), OutputMode::COLLECTIVE, 9);
+        check(plane(array_size, 0, 4),  OutputMode::GATHER,     9);
+    }
+
+    SECTION("subsample") {
+        check(subsample(array_size, {5, 4, 2}), OutputMode::COLLECTIVE, 27);
+        check(subsample(array_size, {5, 4, 2}), OutputMode::GATHER,     27);
+    }
+
+    SECTION("line profile and box") {
+        check(box<3>({0, 7, 20}, {12, 1, 1}), OutputMode::GATHER, 3);
+        check({{3, 5, 8}, {7, 7, 12}, {3, 2, 5}}, OutputMode::COLLECTIVE, 18);
+    }
+
+    SECTION("invalid arguments") {
+        REQUIRE_THROWS_AS( (InSituStream<double, 3>(a, subsample(array_size, {1, 0, 1}), filename)),
+                           std::invalid_argument );
+        REQUIRE_THROWS_AS( (InSituStream<double, 3>(a, box<3>({0, 0, 20}, {1, 1, 8}), filename)),
+                           std::out_of_range );
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (layout.rank() == 0)
+        std::remove(filename.c_str());
+}
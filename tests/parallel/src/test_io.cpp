@@ -0,0 +1,86 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("io - write and read a single file", "test_1") {
+
+    std::array<int, 3> is_periodic = {false, true, false};
+    DArrayLayout<3> layout(MPI_COMM_WORLD, {3, 3, 3}, is_periodic);
+
+    std::array<int, 3> array_size = {6, 9, 12};
+    DArray<double, 3> a(layout, array_size, {1, 1, 1}, {1, 1, 1});
+    DArray<double, 3> b(layout, array_size, {1, 1, 1}, {1, 1, 2});
+
+    // value from the global index
+    auto f = [](int i, int j, int k) { return i + 100*j + 10000*k; };
+
+    std::fill(a.begin(), a.end(), -1);
+    std::fill(b.begin(), b.end(), -2);
+    for (auto [i, j, k] : a.indices()) {
+        auto [gi, gj, gk] = a.global_index({i, j, k});
+        a(i, j, k) = f(gi, gj, gk);
+    }
+
+    const std::string filename = "test_io.darray";
+    a.write(filename);
+
+    SECTION("read back") {
+        b.read(filename);
+        for (auto [i, j, k] : b.indices()) {
+            auto [gi, gj, gk] = b.global_index({i, j, k});
+            REQUIRE( b(i, j, k) == f(gi, gj, gk) );
+        }
+
+        // halo points are left alone
+        REQUIRE( b(-1, 0, 0) == -2 );
+    }
+
+    SECTION("header") {
+        FileHeader header = read_header(filename, MPI_COMM_WORLD);
+        REQUIRE( std::string(header.magic) == "DARRAYS" );
+        REQUIRE( std::string(header.dtype) == "f8" );
+        REQUIRE( header.ndims == 3 );
+        for (int dim = 0; dim != 3; dim++) {
+            REQUIRE( header.shape[dim]    == array_size[dim] );
+            REQUIRE( header.grid[dim]     == 3 );
+            REQUIRE( header.periodic[dim] == is_periodic[dim] );
+        }
+    }
+
+    SECTION("file content") {
+        // global array in Fortran order after the header, no halos
+        if (layout.rank() == 0) {
+            std::ifstream file(filename, std::ios::binary | std::ios::ate);
+            REQUIRE( long(file.tellg()) == FileHeader::data_offset + 6*9*12*long(sizeof(double)) );
+
+            for (auto [gi, gj, gk] : {std::array<int, 3>{0, 0, 0},
+                                      std::array<int, 3>{5, 8, 11},
+                                      std::array<int, 3>{2, 4, 7}}) {
+                double value;
+                file.seekg(FileHeader::data_offset + sizeof(double)*(gi + 6*(gj + 9*gk)));
+                file.read(reinterpret_cast<char*>(&value), sizeof(double));
+                REQUIRE( value == f(gi, gj, gk) );
+            }
+        }
+    }
+
+    SECTION("invalid arguments") {
+        DArray<float, 3> c(layout, array_size, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS_AS( c.read(filename), std::invalid_argument );
+
+        DArray<double, 3> d(layout, {6, 9, 6}, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS_AS( d.read(filename), std::invalid_argument );
+
+        REQUIRE_THROWS_AS( a.read("no_such_file.darray"), std::runtime_error );
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (layout.rank() == 0)
+        std::remove(filename.c_str());
+}
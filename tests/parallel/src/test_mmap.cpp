@@ -0,0 +1,67 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <cstdio>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("mmap - file-backed arrays", "test_1") {
+
+    std::array<int, 3> is_periodic = {true, true, true};
+    DArrayLayout<3> layout(MPI_COMM_WORLD, {3, 3, 3}, is_periodic);
+
+    std::array<int, 3> array_size = {12, 9, 6};
+    std::array<int, 3> nhalo      = {1, 1, 1};
+    const std::string path = "test_mmap." + std::to_string(layout.rank()) + ".bin";
+
+    // value from the global index
+    auto f = [](int i, int j, int k) { return i + 100*j + 10000*k; };
+    auto g = [&](const DArray<double, 3>& a, int i, int j, int k) {
+        auto w = a.wrap_index(a.global_index({i, j, k}));
+        return f(w[0], w[1], w[2]);
+    };
+
+    {
+        DArray<double, 3> a(layout, array_size, nhalo, nhalo, mapped_file<double>(path));
+
+        // new files read as zeros
+        for (auto x : a)
+            REQUIRE( x == 0 );
+
+        for (auto [i, j, k] : a.indices()) {
+            auto [gi, gj, gk] = a.global_index({i, j, k});
+            a(i, j, k) = f(gi, gj, gk);
+        }
+        a.swap_halo();
+        REQUIRE( a(-1, 0, 0) == g(a, -1, 0, 0) );
+        REQUIRE( a( 4, 2, 1) == g(a,  4, 2, 1) );
+
+        // expressions work as usual
+        DArray<double, 3> b(layout, array_size, nhalo, nhalo);
+        b = 2*a;
+        REQUIRE( b(1, 1, 1) == 2*g(a, 1, 1, 1) );
+
+        advise(a, Advice::RANDOM);
+        sync(a);
+    }
+
+    // the data, halos included, is back when mapping the file again
+    {
+        DArray<double, 3> a(layout, array_size, nhalo, nhalo, mapped_file<double>(path));
+        advise(a, Advice::SEQUENTIAL);
+        for (int k = -1; k != 3; k++)
+            for (int j = -1; j != 4; j++)
+                for (int i = -1; i != 5; i++)
+                    REQUIRE( a(i, j, k) == g(a, i, j, k) );
+    }
+
+    // files of another size are not reused
+    auto remap = [&]() {
+        DArray<double, 3> a(layout, array_size, {2, 2, 1}, {2, 2, 1}, mapped_file<double>(path));
+    };
+    REQUIRE_THROWS_AS( remap(), std::invalid_argument );
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,105 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("multigrid - 3D", "test_1") {
+
+    // use this grid layout for tests
+    std::array<int, 3> layout_size = {3, 3, 3};
+    std::array<int, 3> is_periodic = {false, false, false};
+
+    // create layout
+    DArrayLayout<3> layout(MPI_COMM_WORLD, layout_size, is_periodic);
+
+    // local sizes 8, 4, then 6 on a single rank
+    std::array<int, 3> array_size = {3*8, 3*8, 3*8};
+    std::array<int, 3> nhalo      = {1, 1, 1};
+    MultigridHierarchy<double, 3> mg(layout, array_size, nhalo, nhalo);
+
+    REQUIRE( mg.nlevels() == 3 );
+    REQUIRE( mg.array_size(2) == std::array<int, 3>{6, 6, 6} );
+    REQUIRE( mg.grid(1) == std::array<int, 3>{3, 3, 3} );
+    REQUIRE( mg.grid(2) == std::array<int, 3>{1, 1, 1} );
+    REQUIRE( mg.agglomerated(1) == false );
+    REQUIRE( mg.agglomerated(2) == true );
+    REQUIRE( mg.active(1) == true );
+    REQUIRE( mg.active(2) == (layout.rank() == 0) );
+
+    std::vector<std::unique_ptr<DArray<double, 3>>> u;
+    for (int level = 0; level != mg.nlevels(); level++)
+        u.push_back(mg.make_array(level));
+    REQUIRE( (u[2] != nullptr) == mg.active(2) );
+
+    // linear function of the cell centres, in units of the finest cells,
+    // from the global index of a local index i at the given level
+    auto f = [&](int level, int i, int j, int k) {
+        const auto& coords = mg.layout(level).coords();
+        const auto& size   = u[level]->size();
+        double h = 1 << level;
+        double x = (coords[0]*size[0] + i + 0.5)*h;
+        double y = (coords[1]*size[1] + j + 0.5)*h;
+        double z = (coords[2]*size[2] + k + 0.5)*h;
+        return x + 2*y + 3*z;
+    };
+
+    SECTION("restriction") {
+        for (auto [i, j, k] : u[0]->indices())
+            (*u[0])(i, j, k) = f(0, i, j, k);
+
+        for (int level = 0; level != mg.nlevels() - 1; level++) {
+            if (!mg.active(level))
+                continue;
+            mg.restriction(level, *u[level], u[level + 1].get());
+            if (mg.active(level + 1))
+                for (auto [i, j, k] : u[level + 1]->indices())
+                    REQUIRE( (*u[level + 1])(i, j, k) == Approx(f(level + 1, i, j, k)) );
+        }
+    }
+
+    SECTION("prolongation") {
+        // linear interpolation is exact, given the values on the domain
+        // boundaries; halo points with neighbours along all the dimensions
+        // where they are out of the local box are set by the swap
+        for (int level = mg.nlevels() - 1; level != 0; level--) {
+            if (!mg.active(level - 1))
+                continue;
+            if (mg.active(level)) {
+                auto& c = *u[level];
+                const auto& coarse_layout = mg.layout(level);
+                for (int k = -1; k != c.size(2) + 1; k++)
+                    for (int j = -1; j != c.size(1) + 1; j++)
+                        for (int i = -1; i != c.size(0) + 1; i++) {
+                            bool outside = false, swapped = true;
+                            for (auto [n, dim] : {std::pair{i, 0}, std::pair{j, 1}, std::pair{k, 2}}) {
+                                if (n == -1) {
+                                    outside = true;
+                                    swapped = swapped and coarse_layout.has_neighbour_at(Boundary::LEFT, dim);
+                                }
+                                if (n == c.size(dim)) {
+                                    outside = true;
+                                    swapped = swapped and coarse_layout.has_neighbour_at(Boundary::RIGHT, dim);
+                                }
+                            }
+                            c(i, j, k) = (outside and swapped) ? 1e9 : f(level, i, j, k);
+                        }
+            }
+            auto& fine = *u[level - 1];
+            for (auto [i, j, k] : fine.indices())
+                fine(i, j, k) = 1;
+            mg.prolongation(level - 1, u[level].get(), fine);
+            for (auto [i, j, k] : fine.indices())
+                REQUIRE( fine(i, j, k) == Approx(1 + f(level - 1, i, j, k)) );
+        }
+    }
+
+    SECTION("invalid arguments") {
+        REQUIRE_THROWS( MultigridHierarchy<double, 3>(layout, array_size, {0, 1, 1}, nhalo) );
+        REQUIRE_THROWS( MultigridHierarchy<double, 3>(layout, array_size, nhalo, {4, 4, 4}) );
+        if (!mg.active(2))
+            REQUIRE_THROWS( mg.layout(2) );
+    }
+}
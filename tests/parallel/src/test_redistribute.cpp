@@ -0,0 +1,116 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <memory>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("redistribute - 3D", "test_1") {
+
+    std::array<int, 3> is_periodic = {false, false, false};
+    DArrayLayout<3> cubes(MPI_COMM_WORLD, {3, 3, 3},  is_periodic);
+    DArrayLayout<3> bars (MPI_COMM_WORLD, {9, 3, 1},  is_periodic);
+    DArrayLayout<3> slabs(MPI_COMM_WORLD, {27, 1, 1}, is_periodic);
+
+    // local sizes are {18, 6, 6}, {6, 6, 18} and {2, 18, 18}
+    std::array<int, 3> array_size = {54, 18, 18};
+    DArray<double, 3> A(cubes, array_size, {1, 1, 1}, {1, 1, 1});
+    DArray<double, 3> B(bars,  array_size, {2, 1, 1}, {1, 1, 2});
+    DArray<double, 3> C(slabs, array_size, {1, 1, 1}, {1, 1, 1});
+
+    // value from the global index
+    auto f = [](int i, int j, int k) { return i + 1000*j + 1000000*k; };
+
+    std::fill(A.begin(), A.end(), -1);
+    std::fill(B.begin(), B.end(), -1);
+    std::fill(C.begin(), C.end(), -1);
+    for (auto [i, j, k] : A.indices())
+        A(i, j, k) = f(cubes.coords(0)*18 + i, cubes.coords(1)*6 + j, cubes.coords(2)*6 + k);
+
+    SECTION("blocking") {
+        redistribute(B, A);
+        for (auto [i, j, k] : B.indices())
+            REQUIRE( B(i, j, k) == f(bars.coords(0)*6 + i, bars.coords(1)*6 + j, k) );
+
+        // halo points are left alone
+        REQUIRE( B(-1, 0, 0) == -1 );
+
+        redistribute(C, B);
+        for (auto [i, j, k] : C.indices())
+            REQUIRE( C(i, j, k) == f(slabs.coords(0)*2 + i, j, k) );
+    }
+
+    SECTION("non-blocking, repeated") {
+        Redistribution<double, 3> forward(B, A);
+        Redistribution<double, 3> backward(A, B);
+
+        // halo swaps on the same layout can overlap the redistribution
+        DArray<double, 3> W(cubes, array_size, {1, 1, 1}, {1, 1, 1});
+        for (auto [i, j, k] : W.indices())
+            W(i, j, k) = -f(cubes.coords(0)*18 + i, cubes.coords(1)*6 + j, cubes.coords(2)*6 + k);
+
+        for (int n = 0; n != 3; n++) {
+            forward.start();
+            W.swap_halo();
+            forward.wait();
+            if (cubes.coords(0) > 0)
+                REQUIRE( W(-1, 1, 1) == -f(cubes.coords(0)*18 - 1,
+                                           cubes.coords(1)*6 + 1,
+                                           cubes.coords(2)*6 + 1) );
+            for (auto [i, j, k] : A.indices())
+                A(i, j, k) = 0;
+            backward.start();
+            backward.wait();
+            for (auto [i, j, k] : A.indices())
+                REQUIRE( A(i, j, k) == f(cubes.coords(0)*18 + i,
+                                         cubes.coords(1)*6 + j,
+                                         cubes.coords(2)*6 + k) );
+        }
+    }
+
+    SECTION("to a subset of the ranks and back") {
+        // the first eight ranks, then rank 0 alone
+        for (int nranks : {8, 1}) {
+            MPI_Comm comm;
+            const bool member = cubes.rank() < nranks;
+            MPI_Comm_split(MPI_COMM_WORLD, member ? 0 : MPI_UNDEFINED, cubes.rank(), &comm);
+
+            std::unique_ptr<DArrayLayout<3>> layout;
+            std::unique_ptr<DArray<double, 3>> D;
+            if (member) {
+                const int n = nranks == 8 ? 2 : 1;
+                layout = std::make_unique<DArrayLayout<3>>(comm, std::array<int, 3>{n, n, n}, is_periodic);
+                D = std::make_unique<DArray<double, 3>>(*layout, array_size,
+                                                        std::array<int, 3>{1, 1, 1},
+                                                        std::array<int, 3>{1, 1, 1});
+                MPI_Comm_free(&comm);
+            }
+
+            redistribute(D.get(), &A, MPI_COMM_WORLD);
+            if (member) {
+                const auto& s = D->size();
+                for (auto [i, j, k] : D->indices())
+                    REQUIRE( (*D)(i, j, k) == f(layout->coords(0)*s[0] + i,
+                                                layout->coords(1)*s[1] + j,
+                                                layout->coords(2)*s[2] + k) );
+            }
+
+            for (auto [i, j, k] : A.indices())
+                A(i, j, k) = 0;
+            redistribute(&A, static_cast<const DArray<double, 3>*>(D.get()), MPI_COMM_WORLD);
+            for (auto [i, j, k] : A.indices())
+                REQUIRE( A(i, j, k) == f(cubes.coords(0)*18 + i,
+                                         cubes.coords(1)*6 + j,
+                                         cubes.coords(2)*6 + k) );
+        }
+    }
+
+    SECTION("invalid arguments") {
+        REQUIRE_THROWS( redistribute(A, A) );
+
+        DArray<double, 3> V(bars, {54, 18, 36}, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS( redistribute(V, A) );
+    }
+}
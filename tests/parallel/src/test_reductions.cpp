@@ -0,0 +1,93 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <cmath>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("reductions - 3D", "test_1") {
+
+    // use this grid layout for tests
+    std::array<int, 3> layout_size = {3, 3, 3};
+    std::array<int, 3> is_periodic = {false, false, false};
+
+    // create layout
+    DArrayLayout<3> layout(MPI_COMM_WORLD, layout_size, is_periodic);
+
+    // create arrays, with odd row length to exercise the remainder loop
+    std::array<int, 3> array_size = {3*11, 3*4, 3*5};
+    std::array<int, 3> nhalo_out  = {1, 1, 1};
+    std::array<int, 3> nhalo_in   = {1, 1, 1};
+    DArray<double, 3> A(layout, array_size, nhalo_out, nhalo_in);
+    DArray<double, 3> B(layout, array_size, nhalo_out, nhalo_in);
+
+    // halo points must not contribute
+    std::fill(A.begin(), A.end(), 1000.0);
+    std::fill(B.begin(), B.end(), 1000.0);
+
+    // sign alternates with the rank, magnitude is rank + 1
+    const double r    = layout.rank();
+    const double sign = layout.rank() % 2 == 0 ? 1 : -1;
+    for (auto [i, j, k] : A.indices()) {
+        A(i, j, k) = sign*(r + 1);
+        B(i, j, k) = 2;
+    }
+
+    // expected values: 14 positive ranks with values 1, 3, ..., 27 and
+    // 13 negative ranks with values -2, -4, ..., -26
+    const double n = 11*4*5;
+    const double sum1 = n*(14*14 - 13*14);
+    const double sumabs = n*27*28/2;
+    const double sumsq = n*27*28*55/6;
+
+    SECTION("blocking") {
+        REQUIRE( sum(A)     == Approx(sum1) );
+        REQUIRE( max(A)     == 27 );
+        REQUIRE( min(A)     == -26 );
+        REQUIRE( norm1(A)   == Approx(sumabs) );
+        REQUIRE( norm2(A)   == Approx(std::sqrt(sumsq)) );
+        REQUIRE( norminf(A) == 27 );
+        REQUIRE( dot(A, B)  == Approx(2*sum1) );
+    }
+
+    SECTION("threaded") {
+        ThreadPool pool(3);
+        REQUIRE( sum(A, &pool)     == Approx(sum1) );
+        REQUIRE( min(A, &pool)     == -26 );
+        REQUIRE( norm2(A, &pool)   == Approx(std::sqrt(sumsq)) );
+        REQUIRE( dot(A, B, &pool)  == Approx(2*sum1) );
+        REQUIRE( local_sum(A, &pool) == Approx(local_sum(A)) );
+    }
+
+    SECTION("non-blocking") {
+        auto s  = isum(A);
+        auto n2 = inorm2(A);
+        auto d  = idot(A, B);
+        B.swap_halo();
+        REQUIRE( s.get()  == Approx(sum1) );
+        REQUIRE( n2.get() == Approx(std::sqrt(sumsq)) );
+        REQUIRE( d.get()  == Approx(2*sum1) );
+        REQUIRE( d.test() );
+    }
+
+    SECTION("location of extremum") {
+        if (layout.rank() == 13)
+            A(4, 1, 2) = 100;
+        auto ext = argmax(A);
+        REQUIRE( ext.value == 100 );
+        REQUIRE( ext.rank  == 13 );
+        REQUIRE( ext.index == std::array<int, 3>{4, 1, 2} );
+
+        // ties go to the lowest rank, then the first point
+        auto low = argmin(A);
+        REQUIRE( low.value == -26 );
+        REQUIRE( low.rank  == 25 );
+        REQUIRE( low.index == std::array<int, 3>{0, 0, 0} );
+    }
+
+    SECTION("invalid arguments") {
+        DArray<double, 3> C(layout, {3*11, 3*4, 3*4}, nhalo_out, nhalo_in);
+        REQUIRE_THROWS( dot(A, C) );
+    }
+}
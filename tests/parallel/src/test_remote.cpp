@@ -0,0 +1,91 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <vector>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("remote - batched access to global points", "test_1") {
+
+    DArrayLayout<3> layout(MPI_COMM_WORLD, {3, 3, 3}, {true, true, false});
+    DArray<double, 3> a(layout, {12, 9, 6}, {1, 1, 1}, {1, 1, 1});
+
+    // value from the global index
+    auto f = [](int i, int j, int k) { return i + 100*j + 10000*k; };
+    auto g = [&](const std::array<int, 3>& index) {
+        const auto w = a.wrap_index(index);
+        return f(w[0], w[1], w[2]);
+    };
+
+    const int rank = layout.rank();
+    for (auto [i, j, k] : a.indices()) {
+        auto [gi, gj, gk] = a.global_index({i, j, k});
+        a(i, j, k) = f(gi, gj, gk);
+    }
+
+    // a different, scattered set of points on each rank, some repeated,
+    // some wrapped around the periodic dimensions, and none on the last
+    std::vector<std::array<int, 3>> points;
+    if (rank != layout.nprocs() - 1) {
+        for (int n = 0; n != 50; n++)
+            points.push_back({(7*n + rank) % 12, (5*n + 3*rank) % 9, (n + rank) % 6});
+        points.push_back({-1, 9, 0});
+        points.push_back(points.front());
+    }
+
+    SECTION("get") {
+        RemoteAccess<double, 3> access(a, points);
+        REQUIRE( access.size() == points.size() );
+        for (int step = 0; step != 2; step++) {
+            auto values = access.get();
+            for (size_t n = 0; n != points.size(); n++)
+                REQUIRE( values[n] == g(points[n]) );
+        }
+
+        auto values = get(a, points);
+        for (size_t n = 0; n != points.size(); n++)
+            REQUIRE( values[n] == g(points[n]) );
+    }
+
+    SECTION("put and accumulate") {
+        // every rank writes the points at k = rank % 6 of its own column
+        std::vector<std::array<int, 3>> column;
+        for (int j = 0; j != 9; j++)
+            column.push_back({rank % 12, j, rank % 6});
+        std::vector<double> values(column.size(), -1.0);
+        put(a, column, values);
+
+        for (auto [i, j, k] : a.indices()) {
+            auto [gi, gj, gk] = a.global_index({i, j, k});
+            bool written = false;
+            for (int r = 0; r != layout.nprocs(); r++)
+                written = written or (gi == r % 12 and gk == r % 6);
+            REQUIRE( a(i, j, k) == (written ? -1 : f(gi, gj, gk)) );
+        }
+
+        // all ranks add one to the same point
+        for (auto [i, j, k] : a.indices())
+            a(i, j, k) = 0;
+        RemoteAccess<double, 3> access(a, {{11, 8, 5}});
+        double one = 1;
+        access.accumulate(&one);
+        if (a.is_local({11, 8, 5})) {
+            auto [i, j, k] = a.local_index({11, 8, 5});
+            REQUIRE( a(i, j, k) == layout.nprocs() );
+        }
+    }
+
+    SECTION("invalid arguments") {
+        REQUIRE_THROWS( put(a, points, std::vector<double>(points.size() + 1)) );
+
+        // as does a wrong number of values on one rank only
+        REQUIRE_THROWS_AS( put(a, points, std::vector<double>(points.size() + (rank == 5))),
+                           std::invalid_argument );
+
+        // an index out of range on one rank only makes all of them throw
+        std::vector<std::array<int, 3>> wrong = {{0, 0, rank == 13 ? 6 : 0}};
+        REQUIRE_THROWS_AS( (RemoteAccess<double, 3>(a, wrong)), std::out_of_range );
+    }
+}
@@ -0,0 +1,131 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("stencil - 3D", "test_1") {
+
+    // use this grid layout for tests
+    std::array<int, 3> layout_size = {3, 3, 3};
+    std::array<int, 3> is_periodic = {false, false, false};
+
+    // create layout
+    DArrayLayout<3> layout(MPI_COMM_WORLD, layout_size, is_periodic);
+
+    // create arrays
+    std::array<int, 3> array_size = {3*4, 3*5, 3*6};
+    std::array<int, 3> nhalo_out  = {1, 1, 1};
+    std::array<int, 3> nhalo_in   = {1, 1, 1};
+    DArray<double, 3> A(layout, array_size, nhalo_out, nhalo_in);
+    DArray<double, 3> B(layout, array_size, nhalo_out, nhalo_in);
+
+    // fill everything, halo included, with a quadratic function,
+    // whose discrete laplacian is exact
+    for (int k = -1; k != 7; k++)
+        for (int j = -1; j != 6; j++)
+            for (int i = -1; i != 5; i++)
+                A(i, j, k) = i*i + 2*j*j + 3*k*k + i*j;
+
+    SECTION("laplacians") {
+        apply_stencil(B, A, laplacian_7pt<double>());
+        for (auto [i, j, k] : B.indices())
+            REQUIRE( B(i, j, k) == Approx(12) );
+
+        apply_stencil(B, A, laplacian_19pt<double>());
+        for (auto [i, j, k] : B.indices())
+            REQUIRE( B(i, j, k) == Approx(12) );
+
+        apply_stencil(B, A, laplacian_27pt<double>());
+        for (auto [i, j, k] : B.indices())
+            REQUIRE( B(i, j, k) == Approx(12) );
+    }
+
+    SECTION("custom coefficients") {
+        Stencil<double, 3, 2> ddx({{{1, 0, 0}, {-1, 0, 0}}}, {0.5, -0.5});
+        REQUIRE( ddx.width(Boundary::LEFT,  0) == 1 );
+        REQUIRE( ddx.width(Boundary::RIGHT, 1) == 0 );
+
+        apply_stencil(B, A, ddx);
+        for (auto [i, j, k] : B.indices())
+            REQUIRE( B(i, j, k) == Approx(2*i + j) );
+    }
+
+    SECTION("user defined kernel") {
+        apply_stencil(B, A, [](const auto& n) {
+            return n.template at<1>(+1) - n(0, -1, 0) + n(0, 0, 1) - n(0, 0, -1); });
+        for (auto [i, j, k] : B.indices())
+            REQUIRE( B(i, j, k) == Approx(8*j + 2*i + 12*k) );
+
+        // offsets along every dimension, the last one included
+        apply_stencil(B, A, [](const auto& n) { return n(1, 1, 1); });
+        for (auto [i, j, k] : B.indices())
+            REQUIRE( B(i, j, k) == Approx(A(i+1, j+1, k+1)) );
+    }
+
+    SECTION("invalid arguments") {
+        REQUIRE_THROWS( apply_stencil(A, A, laplacian_7pt<double>()) );
+
+        Stencil<double, 3, 1> wide({{{0, 0, 2}}}, {1.0});
+        REQUIRE_THROWS( apply_stencil(B, A, wide) );
+        REQUIRE_THROWS( apply_stencil(B, A, [](const auto& n) { return n(0, 0, 0); }, 2) );
+    }
+}
+
+TEST_CASE("stencil - blocked sweeps", "test_2") {
+
+    // use this grid layout for tests
+    std::array<int, 3> layout_size = {3, 3, 3};
+
+    // averaging stencil, to keep values bounded over several steps
+    Stencil<double, 3, 7> avg({{{ 0,  0,  0},
+                                {-1,  0,  0}, {1, 0, 0},
+                                { 0, -1,  0}, {0, 1, 0},
+                                { 0,  0, -1}, {0, 0, 1}}},
+                              {0.4, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1});
+
+    for (auto periodic : {false, true}) {
+        std::array<int, 3> is_periodic = {periodic, periodic, periodic};
+        DArrayLayout<3> layout(MPI_COMM_WORLD, layout_size, is_periodic);
+
+        // deep halo inside, a single boundary layer outside
+        std::array<int, 3> array_size = {3*8, 3*7, 3*6};
+        std::array<int, 3> nhalo_out  = {1, 1, 1};
+        std::array<int, 3> nhalo_in   = {3, 3, 3};
+        DArray<double, 3> A(layout, array_size, nhalo_out, nhalo_in);
+        DArray<double, 3> B(layout, array_size, nhalo_out, nhalo_in);
+        DArray<double, 3> C(layout, array_size, nhalo_out, nhalo_in);
+
+        // same boundary values on all ranks, including in the corners
+        for (auto& a : {&A, &B, &C})
+            std::fill(a->begin(), a->end(), 0.5);
+        for (auto [i, j, k] : A.indices())
+            A(i, j, k) = i*j - k + layout.rank();
+        A.swap_halo();
+
+        SECTION("spatial tiling, periodic = " + std::to_string(periodic)) {
+            apply_stencil(B, A, laplacian_7pt<double>());
+            apply_stencil(C, A, laplacian_7pt<double>(), {5, 3, 2});
+            for (auto [i, j, k] : B.indices())
+                REQUIRE( C(i, j, k) == B(i, j, k) );
+
+            REQUIRE_THROWS( apply_stencil(C, A, laplacian_7pt<double>(), {0, 3, 2}) );
+        }
+
+        SECTION("temporal blocking, periodic = " + std::to_string(periodic)) {
+            apply_stencil_steps(C, A, avg, 3, {8, 3, 2});
+
+            // reference, with a halo swap after each step
+            apply_stencil(B, A, avg); B.swap_halo();
+            apply_stencil(A, B, avg); A.swap_halo();
+            apply_stencil(B, A, avg);
+            for (auto [i, j, k] : B.indices())
+                REQUIRE( C(i, j, k) == Approx(B(i, j, k)) );
+
+            REQUIRE_THROWS( apply_stencil_steps(C, A, avg, 4, {8, 3, 2}) );
+            REQUIRE_THROWS( apply_stencil_steps(C, A, avg, 0, {8, 3, 2}) );
+        }
+    }
+}
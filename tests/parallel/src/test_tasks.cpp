@@ -0,0 +1,100 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <atomic>
+#include <array>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("tasks - task graph", "test_1") {
+
+    ThreadPool pool(3);
+
+    SECTION("independent tasks") {
+        TaskGraph graph;
+        std::array<std::atomic<int>, 100> count = {};
+        for (int n = 0; n != 100; n++)
+            graph.add_task([&, n] { count[n]++; });
+        graph.execute(pool);
+        for (auto& c : count)
+            REQUIRE( c == 1 );
+    }
+
+    SECTION("tasks wait for their events") {
+        TaskGraph graph;
+        int e0 = graph.add_event();
+        int e1 = graph.add_event();
+
+        std::atomic<int> signalled = 0;
+        std::atomic<bool> ok = true;
+        for (int n = 0; n != 20; n++) {
+            graph.add_task([&] { if (signalled < 1) ok = false; }, {e0});
+            graph.add_task([&] { if (signalled < 2) ok = false; }, {e0, e1});
+            graph.add_task([&] { });
+        }
+
+        int npolls = 0;
+        graph.execute(pool, [&] {
+            npolls++;
+            if (npolls == 10) { signalled = 1; graph.signal(e0); }
+            if (npolls == 20) { signalled = 2; graph.signal(e1); }
+            return npolls == 20;
+        });
+        REQUIRE( ok );
+    }
+
+    SECTION("exceptions") {
+        TaskGraph graph;
+        graph.add_task([] { throw std::runtime_error("error"); });
+        graph.add_task([] { });
+        REQUIRE_THROWS( graph.execute(pool) );
+    }
+}
+
+TEST_CASE("tasks - halo dependencies", "test_2") {
+
+    // use this grid layout for tests
+    std::array<int, 3> layout_size = {3, 3, 3};
+
+    for (auto periodic : {false, true}) {
+        std::array<int, 3> is_periodic = {periodic, periodic, periodic};
+        DArrayLayout<3> layout(MPI_COMM_WORLD, layout_size, is_periodic);
+
+        // create arrays
+        std::array<int, 3> array_size = {3*8, 3*6, 3*5};
+        std::array<int, 3> nhalo_out  = {1, 1, 1};
+        std::array<int, 3> nhalo_in   = {1, 1, 1};
+        DArray<double, 3> A(layout, array_size, nhalo_out, nhalo_in);
+        DArray<double, 3> B(layout, array_size, nhalo_out, nhalo_in);
+        DArray<double, 3> C(layout, array_size, nhalo_out, nhalo_in);
+
+        std::fill(A.begin(), A.end(), -1);
+        for (auto [i, j, k] : A.indices())
+            A(i, j, k) = i + 2*j + 3*k + 10*layout.rank();
+
+        ThreadPool pool(3);
+        parallel_for_halo(pool, A, {4, 2, 2}, 1, [&](const auto& tile) {
+            for (auto [i, j, k] : tile.indices())
+                C(i, j, k) = A(i+1, j, k) + A(i-1, j, k) + A(i, j+1, k) + 
+                             A(i, j-1, k) + A(i, j, k+1) + A(i, j, k-1);
+        });
+
+        // only the faces are swapped, so that no region sent overlaps one
+        // being received: edges and corners of the halo are left alone
+        REQUIRE( A(-1, -1, 0)  == -1 );
+        REQUIRE( A(8, 0, -1)   == -1 );
+        REQUIRE( A(-1, 6, 5)   == -1 );
+        if (layout.has_neighbour_at(Boundary::LEFT, 0))
+            REQUIRE( A(-1, 0, 0) != -1 );
+
+        // reference, with a blocking swap
+        A.swap_halo();
+        for (auto [i, j, k] : A.indices())
+            B(i, j, k) = A(i+1, j, k) + A(i-1, j, k) + A(i, j+1, k) + 
+                         A(i, j-1, k) + A(i, j, k+1) + A(i, j, k-1);
+
+        for (auto [i, j, k] : A.indices())
+            REQUIRE( C(i, j, k) == B(i, j, k) );
+    }
+}
@@ -0,0 +1,93 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <atomic>
+#include <array>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("threads - thread pool", "test_1") {
+
+    for (int nthreads : {1, 3}) {
+        ThreadPool pool(nthreads);
+        REQUIRE( pool.size() == nthreads );
+
+        // every thread runs the job once, in every run
+        std::array<std::atomic<int>, 3> count = {};
+        for (int n = 0; n != 10; n++)
+            pool.run([&](int id) { count[id]++; });
+        for (int id = 0; id != nthreads; id++)
+            REQUIRE( count[id] == 10 );
+
+        // exceptions are forwarded to the caller
+        REQUIRE_THROWS( pool.run([&](int id) {
+            if (id == nthreads - 1) throw std::runtime_error("error"); }) );
+    }
+
+    REQUIRE_THROWS( ThreadPool(0) );
+}
+
+TEST_CASE("threads - parallel loops", "test_2") {
+
+    // use this grid layout for tests
+    std::array<int, 3> layout_size = {3, 3, 3};
+    std::array<int, 3> is_periodic = {true, true, true};
+
+    // create layout
+    DArrayLayout<3> layout(MPI_COMM_WORLD, layout_size, is_periodic);
+
+    // create arrays
+    std::array<int, 3> array_size = {3*4, 3*5, 3*7};
+    std::array<int, 3> nhalo_out  = {1, 1, 1};
+    std::array<int, 3> nhalo_in   = {1, 1, 1};
+    DArray<double, 3> A(layout, array_size, nhalo_out, nhalo_in);
+    DArray<double, 3> B(layout, array_size, nhalo_out, nhalo_in);
+
+    ThreadPool pool(3);
+    first_touch(pool, A, 0);
+    first_touch(pool, B, -1);
+    REQUIRE( static_cast<size_t>(std::count(A.begin(), A.end(), 0))  == A.nelements() );
+    REQUIRE( static_cast<size_t>(std::count(B.begin(), B.end(), -1)) == B.nelements() );
+
+    SECTION("blocks cover the range once") {
+        auto range = A.indices();
+        int n = 0;
+        for (int part = 0; part != 3; part++) {
+            const auto part_range = block(range, part, 3);
+            n += std::distance(part_range.begin(), part_range.end());
+        }
+        REQUIRE( n == 4*5*7 );
+    }
+
+    SECTION("index loop") {
+        parallel_for(pool, A.indices(), [&](const auto& index) {
+            auto [i, j, k] = index;
+            A(i, j, k) = i + 10*j + 100*k;
+        });
+        for (auto [i, j, k] : A.indices())
+            REQUIRE( A(i, j, k) == i + 10*j + 100*k );
+    }
+
+    SECTION("tile loop") {
+        parallel_for(pool, A.tiles({4, 2, 3}), [&](const auto& tile) {
+            for (auto [i, j, k] : tile.indices())
+                A(i, j, k) += 1;
+        });
+        for (auto [i, j, k] : A.indices())
+            REQUIRE( A(i, j, k) == 1 );
+    }
+
+    SECTION("overlap communication and computation") {
+        std::fill(A.begin(), A.end(), layout.rank());
+        parallel_for_overlap(pool, [&] { A.swap_halo(); }, B.indices(),
+            [&](const auto& index) {
+                auto [i, j, k] = index;
+                B(i, j, k) = 2;
+            });
+        for (auto [i, j, k] : B.indices())
+            REQUIRE( B(i, j, k) == 2 );
+        REQUIRE( A(-1, 0, 0) == layout.rank_of_neighbour_at(Boundary::LEFT, 0) );
+        REQUIRE( A(0, 5, 0)  == layout.rank_of_neighbour_at(Boundary::RIGHT, 1) );
+    }
+}
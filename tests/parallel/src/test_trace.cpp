@@ -0,0 +1,112 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("trace - timeline of halo swaps and user regions", "test_1") {
+
+    DArrayLayout<3> layout(MPI_COMM_WORLD, {3, 3, 3}, {true, true, true});
+    DArray<double, 3> a(layout, {6, 6, 6}, {1, 1, 1}, {1, 1, 1});
+
+    // number of events with given name
+    auto count = [](const std::string& name) {
+        int n = 0;
+        for (const auto& event : Tracer::instance().events())
+            n += std::string(event.name) == name;
+        return n;
+    };
+
+    SECTION("events are recorded while tracing is on") {
+        a.swap_halo();
+        start_tracing();
+        a.swap_halo();
+        {
+            TraceRegion region("compute");
+            HaloSwap<double, 3> swap(a);
+            swap.wait();
+        }
+        stop_tracing();
+        a.swap_halo();
+
+        // one sendrecv for each of the 6 halo regions
+        REQUIRE( count("swap_halo")      == 1  );
+        REQUIRE( count("sendrecv")       == 6  );
+        REQUIRE( count("HaloSwap::post") == 1  );
+        REQUIRE( count("HaloSwap::wait") == 1  );
+        REQUIRE( count("compute")        == 1  );
+
+        // regions nest
+        const auto events = Tracer::instance().events();
+        const auto& last  = events.back();
+        REQUIRE( std::string(last.name) == "compute" );
+        REQUIRE( std::string(last.category) == "user" );
+        for (const auto& event : events) {
+            REQUIRE( event.begin <= event.end );
+            if (std::string(event.name).rfind("HaloSwap", 0) == 0) {
+                REQUIRE( event.begin >= last.begin );
+                REQUIRE( event.end   <= last.end   );
+            }
+        }
+    }
+
+    SECTION("the ring buffer keeps the last events") {
+        start_tracing(4);
+        const char* names[] = {"a", "b", "c", "d", "e", "f"};
+        for (auto name : names)
+            TraceRegion region(name);
+        stop_tracing();
+
+        const auto events = Tracer::instance().events();
+        REQUIRE( events.size() == 4 );
+        REQUIRE( std::string(events.front().name) == "c" );
+        REQUIRE( std::string(events.back().name)  == "f" );
+        REQUIRE( Tracer::instance().dropped() == 2 );
+
+        REQUIRE_THROWS_AS( start_tracing(0), std::invalid_argument );
+    }
+
+    SECTION("clocks are aligned and the trace is written") {
+        // on a single machine, the ranks share the clock
+        const double offset = clock_offset(MPI_COMM_WORLD);
+        REQUIRE( std::abs(offset) < 1 );
+
+        // names are escaped and not truncated
+        const std::string long_name = "say \"hi\" \\ " + std::string(1000, 'x');
+        start_tracing();
+        a.swap_halo();
+        { TraceRegion region(long_name.c_str()); }
+        stop_tracing();
+
+        const std::string filename = "test_trace.json";
+        write_trace(filename);
+        if (layout.rank() == 0) {
+            std::ifstream file(filename);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            const std::string text = stream.str();
+
+            REQUIRE( text.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [") == 0 );
+            REQUIRE( text.find("\"args\": {\"name\": \"rank 26\"}") != std::string::npos );
+            REQUIRE( text.find("\"name\": \"swap_halo\", \"cat\": \"halo\", \"ph\": \"X\"")
+                     != std::string::npos );
+            REQUIRE( text.substr(text.size() - 5) == "}\n]}\n" );
+            REQUIRE( text.find("\"name\": \"say \\\"hi\\\" \\\\ " + std::string(1000, 'x')
+                               + "\", \"cat\": \"user\"") != std::string::npos );
+
+            // one swap_halo event per rank
+            size_t n = 0;
+            for (size_t pos = 0; (pos = text.find("\"swap_halo\"", pos)) != std::string::npos; pos++)
+                n++;
+            REQUIRE( n == 27 );
+            std::remove(filename.c_str());
+        }
+    }
+}
@@ -0,0 +1,178 @@
+#include "DArrays.hpp"
+#include <catch.hpp>
+#include <array>
+#include <iostream>
+
+// import all
+using namespace DArrays;
+
+TEST_CASE("transpose - 3D slabs", "test_1") {
+
+    // slabs along each dimension
+    std::array<int, 3> is_periodic = {false, false, false};
+    DArrayLayout<3> layout_x(MPI_COMM_WORLD, {27, 1, 1}, is_periodic);
+    DArrayLayout<3> layout_y(MPI_COMM_WORLD, {1, 27, 1}, is_periodic);
+    DArrayLayout<3> layout_z(MPI_COMM_WORLD, {1, 1, 27}, is_periodic);
+
+    // create arrays, with different halos
+    std::array<int, 3> array_size = {27*2, 27*3, 27*2};
+    DArray<double, 3> X(layout_x, array_size, {1, 1, 1}, {1, 1, 1});
+    DArray<double, 3> Y(layout_y, array_size, {1, 2, 1}, {2, 1, 1});
+    DArray<double, 3> Z(layout_z, array_size, {3, 1, 1}, {1, 1, 1});
+
+    // value from the global index
+    auto f = [](int i, int j, int k) { return i + 1000*j + 1000000*k; };
+
+    const int rank = layout_x.rank();
+    std::fill(X.begin(), X.end(), -1);
+    std::fill(Y.begin(), Y.end(), -1);
+    for (auto [i, j, k] : X.indices())
+        X(i, j, k) = f(rank*2 + i, j, k);
+
+    SECTION("blocking") {
+        transpose(Y, X);
+        for (auto [i, j, k] : Y.indices())
+            REQUIRE( Y(i, j, k) == f(i, rank*3 + j, k) );
+
+        // halo points are left alone
+        REQUIRE( Y(0, -1, 0) == -1 );
+
+        transpose(Z, Y);
+        for (auto [i, j, k] : Z.indices())
+            REQUIRE( Z(i, j, k) == f(i, j, rank*2 + k) );
+    }
+
+    SECTION("non-blocking, repeated") {
+        SlabTranspose<double, 3> forward(Y, X);
+        SlabTranspose<double, 3> backward(X, Y);
+
+        // halo swaps on the same layout can overlap the transpose
+        DArray<double, 3> W(layout_x, array_size, {1, 1, 1}, {1, 1, 1});
+        for (auto [i, j, k] : W.indices())
+            W(i, j, k) = -f(rank*2 + i, j, k);
+
+        for (int n = 0; n != 3; n++) {
+            forward.start();
+            W.swap_halo();
+            forward.wait();
+            if (rank > 0)
+                REQUIRE( W(-1, 1, 1) == -f(rank*2 - 1, 1, 1) );
+            if (rank < 26)
+                REQUIRE( W(2, 1, 1) == -f(rank*2 + 2, 1, 1) );
+            for (auto [i, j, k] : X.indices())
+                X(i, j, k) = 0;
+            backward.start();
+            backward.wait();
+            for (auto [i, j, k] : X.indices())
+                REQUIRE( X(i, j, k) == f(rank*2 + i, j, k) );
+        }
+    }
+
+    SECTION("invalid arguments") {
+        DArray<double, 3> W(layout_x, array_size, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS( transpose(W, X) );
+        REQUIRE_THROWS( transpose(X, X) );
+
+        DArray<double, 3> V(layout_y, {27*2, 27*3, 27*4}, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS( transpose(V, X) );
+
+        DArrayLayout<3> pencils(MPI_COMM_WORLD, {3, 9, 1}, is_periodic);
+        DArray<double, 3> P(pencils, array_size, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS( transpose(P, X) );
+    }
+}
+
+TEST_CASE("transpose - 3D pencils", "test_2") {
+
+    // x, y and z pencils over a 3 x 9 processor grid
+    std::array<int, 3> is_periodic = {false, false, false};
+    DArrayLayout<3> layout_x(MPI_COMM_WORLD, {1, 3, 9}, is_periodic);
+    DArrayLayout<3> layout_y(MPI_COMM_WORLD, {3, 1, 9}, is_periodic);
+    DArrayLayout<3> layout_z(MPI_COMM_WORLD, {3, 9, 1}, is_periodic);
+
+    // local sizes are {9, 6, 2}, {3, 18, 2} and {3, 2, 18}, so that
+    // some of the chunks have different sizes
+    std::array<int, 3> array_size = {9, 18, 18};
+    DArray<double, 3> X(layout_x, array_size, {1, 1, 1}, {1, 1, 1});
+    DArray<double, 3> Y(layout_y, array_size, {1, 2, 1}, {1, 1, 1});
+    DArray<double, 3> Z(layout_z, array_size, {1, 1, 1}, {1, 1, 2});
+
+    // value from the global index
+    auto f = [](int i, int j, int k) { return i + 1000*j + 1000000*k; };
+
+    // the coordinates of a rank in the 3 x 9 grid are the same in all layouts
+    const int a = layout_x.coords(1);
+    const int b = layout_x.coords(2);
+    std::fill(X.begin(), X.end(), -1);
+    std::fill(Y.begin(), Y.end(), -1);
+    std::fill(Z.begin(), Z.end(), -1);
+    for (auto [i, j, k] : X.indices())
+        X(i, j, k) = f(i, a*6 + j, b*2 + k);
+
+    for (int nchunks : {1, 2, 3, 4}) {
+        PencilTranspose<double, 3> xy(Y, X, nchunks);
+        PencilTranspose<double, 3> yz(Z, Y, nchunks);
+        PencilTranspose<double, 3> zy(Y, Z, nchunks);
+        PencilTranspose<double, 3> yx(X, Y, nchunks);
+
+        xy.execute();
+        for (auto [i, j, k] : Y.indices())
+            REQUIRE( Y(i, j, k) == f(a*3 + i, j, b*2 + k) );
+
+        // halo points are left alone
+        REQUIRE( Y(0, -1, 0) == -1 );
+
+        yz.execute();
+        for (auto [i, j, k] : Z.indices())
+            REQUIRE( Z(i, j, k) == f(a*3 + i, b*2 + j, k) );
+
+        // and back
+        std::fill(Y.begin(), Y.end(), -1);
+        zy.execute();
+        for (auto [i, j, k] : Y.indices())
+            REQUIRE( Y(i, j, k) == f(a*3 + i, j, b*2 + k) );
+
+        for (auto [i, j, k] : X.indices())
+            X(i, j, k) = 0;
+        yx.execute();
+        for (auto [i, j, k] : X.indices())
+            REQUIRE( X(i, j, k) == f(i, a*6 + j, b*2 + k) );
+    }
+
+    SECTION("one-off") {
+        pencil_transpose(Y, X);
+        for (auto [i, j, k] : Y.indices())
+            REQUIRE( Y(i, j, k) == f(a*3 + i, j, b*2 + k) );
+    }
+
+    SECTION("invalid arguments") {
+        REQUIRE_THROWS( pencil_transpose(X, X) );
+        REQUIRE_THROWS( pencil_transpose(Y, X, 0) );
+
+        // x to z would need a 9 x 3 grid for the z pencils
+        REQUIRE_THROWS( pencil_transpose(Z, X) );
+
+        // on a 3 x 3 grid the sizes agree, but ranks would receive blocks
+        // they do not own along y
+        MPI_Comm comm;
+        MPI_Comm_split(MPI_COMM_WORLD, layout_x.rank() < 9 ? 0 : MPI_UNDEFINED, 0, &comm);
+        if (comm != MPI_COMM_NULL) {
+            {
+                DArrayLayout<3> square_x(comm, {1, 3, 3}, is_periodic);
+                DArrayLayout<3> square_z(comm, {3, 3, 1}, is_periodic);
+                DArray<double, 3> SX(square_x, {9, 9, 9}, {1, 1, 1}, {1, 1, 1});
+                DArray<double, 3> SZ(square_z, {9, 9, 9}, {1, 1, 1}, {1, 1, 1});
+                REQUIRE_THROWS( pencil_transpose(SZ, SX) );
+            }
+            MPI_Comm_free(&comm);
+        }
+
+        DArray<double, 3> V(layout_y, {9, 18, 36}, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS( pencil_transpose(V, X) );
+
+        DArrayLayout<3> slabs(MPI_COMM_WORLD, {27, 1, 1}, is_periodic);
+        DArray<double, 3> S(slabs, {54, 18, 18}, {1, 1, 1}, {1, 1, 1});
+        DArray<double, 3> T(layout_x, {54, 18, 18}, {1, 1, 1}, {1, 1, 1});
+        REQUIRE_THROWS( pencil_transpose(S, T) );
+    }
+}
@@ -1,6 +1,9 @@
 #include "DArrays.hpp"
 #include "catch.hpp"
+#include <execution>
+#include <algorithm>
 #include <iostream>
+#include <atomic>
 
 TEST_CASE("Testing linear range", "[LinRange]") {
     int i = 0;
@@ -231,7 +234,151 @@ TEST_CASE("Testing index range", "[IndexRange]") {
             REQUIRE( (c >  b) == true );
             REQUIRE( (c <  b) == false );
             REQUIRE( (c != b) == true );
+            REQUIRE( (c >= b) == true );
+            REQUIRE( (c <= b) == false );
+        }
+
+        SECTION("distance and arithmetic") {
+            REQUIRE( rng.end() - rng.begin() == 60 );
+            REQUIRE( std::distance(rng.begin(), rng.end()) == 60 );
+
+            std::array<int, 3> expected = {1, 1, 1};
+            REQUIRE( *(b + 16) == expected );
+            REQUIRE( *(16 + b) == expected );
+            REQUIRE( b[16] == expected );
+            REQUIRE( *(rng.end() - 44) == expected );
+            REQUIRE( (b + 16) - b == 16 );
+        }
+
+        SECTION("increment and decrement") {
+            // going back and forth across the carries
+            auto c = rng.begin();
+            for (int n = 0; n != 59; n++) {
+                auto d = c++;
+                REQUIRE( *(++d) == *c );
+                REQUIRE( *(--d) == *(c - 1) );
+            }
+            std::array<int, 3> expected = {2, 3, 4};
+            REQUIRE( *c == expected );
+            REQUIRE( ++c == rng.end() );
         }
     }
 }
 
+
+TEST_CASE("Testing index range with origin", "[IndexRange]") {
+    int i = 0;
+    std::array<std::array<int, 2>, 6> exact = {{{2, -1}, {3, -1}, {2, 0}, {3, 0}, {2, 1}, {3, 1}}};
+    std::array<int, 2> origin = {2, -1};
+    std::array<int, 2> size   = {2,  3};
+    for (auto val : DArrays::Iterators::IndexRange<2>(origin, size)) {
+        REQUIRE(val == exact[i++]);
+    }
+    REQUIRE(i == 6);
+
+    auto b = DArrays::Iterators::IndexRange<2>(origin, size).begin();
+    b += 3;
+    REQUIRE( *b == exact[3] );
+    b -= 2;
+    REQUIRE( *b == exact[1] );
+}
+
+TEST_CASE("Testing tile range", "[TileRange]") {
+    std::array<int, 2> size  = {5, 4};
+    std::array<int, 2> shape = {2, 3};
+    DArrays::Iterators::TileRange<2> tiles(size, shape);
+
+    std::array<int, 2> ntiles = {3, 2};
+    REQUIRE( tiles.ntiles() == ntiles );
+
+    // tiles on the high end are cut
+    std::array<std::array<int, 2>, 6> origins = {{{0, 0}, {2, 0}, {4, 0}, {0, 3}, {2, 3}, {4, 3}}};
+    std::array<std::array<int, 2>, 6> sizes   = {{{2, 3}, {2, 3}, {1, 3}, {2, 1}, {2, 1}, {1, 1}}};
+    int n = 0;
+    for (auto tile : tiles) {
+        REQUIRE( tile.origin() == origins[n] );
+        REQUIRE( tile.size()   == sizes[n] );
+        n++;
+    }
+    REQUIRE( n == 6 );
+
+    // each index is visited exactly once
+    std::array<std::array<int, 4>, 5> count = {};
+    for (auto tile : tiles)
+        for (auto [i, j] : tile.indices())
+            count[i][j]++;
+    for (auto& row : count)
+        for (auto c : row)
+            REQUIRE( c == 1 );
+
+    std::array<int, 2> bad_shape = {0, 3};
+    REQUIRE_THROWS( DArrays::Iterators::TileRange<2>(size, bad_shape) );
+}
+
+TEST_CASE("Testing index range splitting", "[IndexRange]") {
+    DArrays::Iterators::IndexRange<3> rng(3, 4, 5);
+
+    // sub-ranges are consecutive and have the same length, to within one
+    std::vector<std::array<int, 3>> all;
+    for (int part = 0; part != 7; part++) {
+        auto sub = rng.split(part, 7);
+        REQUIRE( (sub.length() == 8 or sub.length() == 9) );
+        for (auto index : sub)
+            all.push_back(index);
+    }
+    REQUIRE( all.size() == 60 );
+    REQUIRE( std::equal(all.begin(), all.end(), rng.begin()) );
+
+    // a sub-range can be split further
+    auto sub = rng.split(1, 2).split(1, 3);
+    REQUIRE( sub.length() == 10 );
+    std::array<int, 3> expected = {1, 1, 3};
+    REQUIRE( *sub.begin() == expected );
+}
+
+TEST_CASE("Testing index range with parallel algorithms", "[IndexRange]") {
+    DArrays::Iterators::IndexRange<3> rng(13, 17, 19);
+    std::vector<std::atomic<int>> count(13*17*19);
+    std::for_each(std::execution::par_unseq, rng.begin(), rng.end(), [&](auto index) {
+        auto [i, j, k] = index;
+        count[i + 13*j + 13*17*k]++;
+    });
+    for (auto& c : count)
+        REQUIRE( c == 1 );
+
+    long sum = std::transform_reduce(std::execution::par, rng.begin(), rng.end(), 0L,
+                                     std::plus<>(), [](auto index) { return index[2]; });
+    REQUIRE( sum == 13*17*(18*19/2) );
+}
+
+TEST_CASE("Testing coloured index range", "[ColouredIndexRange]") {
+    std::array<int, 3> origin = {-1, 2, 0};
+    std::array<int, 3> size   = {5, 3, 2};
+
+    // the two colours partition the box
+    std::array<std::array<std::array<int, 2>, 3>, 5> count = {};
+    for (int parity : {0, 1}) {
+        DArrays::Iterators::ColouredIndexRange<3> rng(origin, size, parity);
+        int n = 0;
+        for (auto [i, j, k] : rng) {
+            REQUIRE( ((i + j + k) & 1) == parity );
+            count[i + 1][j - 2][k]++;
+            n++;
+        }
+        REQUIRE( n == 15 );
+
+        // rows start at the first point of the colour
+        std::array<int, 3> index = {-1, 2, 0};
+        REQUIRE( rng.offset(index) == (parity == 1 ? 0 : 1) );
+    }
+    for (auto& plane : count)
+        for (auto& row : plane)
+            for (auto c : row)
+                REQUIRE( c == 1 );
+
+    // rows of a single point may hold no point of the colour
+    std::array<int, 2> thin = {1, 4};
+    DArrays::Iterators::ColouredIndexRange<2> rng({0, 0}, thin, 0);
+    std::vector<std::array<int, 2>> all(rng.begin(), rng.end());
+    REQUIRE( all == std::vector<std::array<int, 2>>{{0, 0}, {0, 2}} );
+}